@@ -34,7 +34,31 @@ func _ready():
 	get_node("Buttons/clear").connect("pressed", self, "_clear")
 	get_node("Controls/allowzip").connect("pressed",self, "_update_list")
 	get_node("Filter2/value").connect("text_changed", self, "_search_games")
-	
+	_parse_cmdline()
+
+# Start a headless smoke run when the player is launched with
+#	--smoke-run=<game list> [--smoke-out=<results.json>] [--smoke-frames=N] [--smoke-timeout=SEC]
+# The game list is a text file with one game path per line
+func _parse_cmdline():
+	var options = {}
+	for arg in OS.get_cmdline_args():
+		if arg.begins_with("--smoke-") and arg.find("=") != -1:
+			options[arg.substr(2, arg.find("=") - 2)] = arg.substr(arg.find("=") + 1, arg.length())
+	if not options.has("smoke-run"):
+		return
+	var out = "user://smoke_results.json"
+	var frames = 300
+	var timeout = 60.0
+	if options.has("smoke-out"):
+		out = options["smoke-out"]
+	if options.has("smoke-frames"):
+		frames = int(options["smoke-frames"])
+	if options.has("smoke-timeout"):
+		timeout = float(options["smoke-timeout"])
+	if OK != SceneTreeManager.new().run_smoke_test(options["smoke-run"], out, frames, timeout, true):
+		print("Failed to start smoke run from: ", options["smoke-run"])
+		get_tree().quit()
+
 func _update_list():
 	_game_list.clear()
 	for g in games:
@@ -123,13 +147,11 @@ func _play():
 #	Tt could be a project folder which contains the engine.cfg file
 #	Or it could be the pck/zip file that packed from godot project
 func start_project(path):
-	PathRemap.clear_remaps()
 	var scene_tree = get_tree()
 	var show_collision_hint = get_node("Controls/show_collisions").is_pressed()
 	var show_navigation_hint = get_node("Controls/show_navigation").is_pressed()
 	var manager = SceneTreeManager.new()
 	if OK == manager.load_project(path):
-		remap_path(path)
 		if OK == manager.restart_scene_tree():
 			scene_tree.set_debug_collisions_hint(show_collision_hint)
 			scene_tree.set_debug_navigation_hint(show_navigation_hint)
@@ -138,23 +160,6 @@ func start_project(path):
 	else:
 		OS.alert(str("Failed load game from: ", path), "Error")
 
-# remap all files under target path as files under res://
-# Means the folder targetPath is same with res://
-# @param targetPath: String the directory of the folder to remap with
-func remap_path(targetPath):
-	var dir = Directory.new()
-	if OK == dir.open(targetPath):
-		print(">>>>>>>>>> Remap 'res://' to '", targetPath, "' <<<<<<<<<<<")
-		var pathes = get_files_in_dir(targetPath, true, true)
-		for abspath in pathes:
-			var rpath = abspath.replace(targetPath, "")
-			if rpath.begins_with("/"):
-				rpath = rpath.substr(1, rpath.length())
-			var respath = str("res://", rpath)
-			print(abspath, " => ", respath)
-			PathRemap.add_remap(respath, abspath)
-		
-
 # Get file pathes in a list under target folder
 # @param path:String The folder to search from
 # @param with_dirs:boolean = false Includes directories
@@ -0,0 +1,128 @@
+#include "frame_recorder.h"
+#include <scene/main/scene_main_loop.h>
+#include <scene/main/viewport.h>
+#include <main/performance.h>
+#include <core/os/os.h>
+#include <core/error_macros.h>
+
+FrameRecorder::FrameRecorder():Object() {
+
+	head=0;
+	tail=0;
+	running=false;
+	frame_count=0;
+	dropped=0;
+	file=NULL;
+	thread=NULL;
+}
+
+FrameRecorder::~FrameRecorder() {
+
+	stop();
+}
+
+void FrameRecorder::_bind_methods() {
+	ObjectTypeDB::bind_method(_MD("_idle_frame"), &FrameRecorder::_idle_frame);
+	ObjectTypeDB::bind_method(_MD("_tree_exiting"), &FrameRecorder::_tree_exiting);
+}
+
+Error FrameRecorder::start(const String& p_path) {
+
+	ERR_EXPLAIN("Frame recorder is already running");
+	ERR_FAIL_COND_V(thread, ERR_ALREADY_IN_USE);
+
+	Error err;
+	file = FileAccess::open(p_path,FileAccess::WRITE,&err);
+	if (err!=OK)
+		return err;
+
+	file->store_buffer((const uint8_t*)"GPFR",4);
+	file->store_32(FILE_VERSION);
+	file->store_32(FRAME_BYTES);
+
+	head=0;
+	tail=0;
+	frame_count=0;
+	dropped=0;
+	running=true;
+	thread = Thread::create(_thread_func,this);
+	SceneTree::get_singleton()->connect("idle_frame",this,"_idle_frame");
+	// the scene tree is gone by the time the module is unregistered
+	SceneTree::get_singleton()->get_root()->connect("exit_tree",this,"_tree_exiting");
+	return OK;
+}
+
+void FrameRecorder::stop() {
+
+	if (!thread)
+		return;
+
+	SceneTree *scenetree = SceneTree::get_singleton();
+	if (scenetree && scenetree->is_connected("idle_frame",this,"_idle_frame"))
+		scenetree->disconnect("idle_frame",this,"_idle_frame");
+	if (scenetree && scenetree->get_root()->is_connected("exit_tree",this,"_tree_exiting"))
+		scenetree->get_root()->disconnect("exit_tree",this,"_tree_exiting");
+
+	running=false;
+	Thread::wait_to_finish(thread);
+	memdelete(thread);
+	thread=NULL;
+
+	memdelete(file);
+	file=NULL;
+}
+
+void FrameRecorder::_tree_exiting() {
+
+	stop();
+}
+
+void FrameRecorder::_idle_frame() {
+
+	uint32_t h = head.load(std::memory_order_relaxed);
+	if (h-tail.load(std::memory_order_acquire) >= RING_SIZE) {
+		dropped++;
+		return;
+	}
+
+	Performance *perf = Performance::get_singleton();
+	Frame &f = ring[h&(RING_SIZE-1)];
+	f.frame = frame_count++;
+	f.delta = SceneTree::get_singleton()->get_idle_process_time();
+	f.process_time = perf->get_monitor(Performance::TIME_PROCESS);
+	f.physics_time = perf->get_monitor(Performance::TIME_FIXED_PROCESS);
+	f.draw_calls = perf->get_monitor(Performance::RENDER_DRAW_CALLS_IN_FRAME);
+	f.objects = perf->get_monitor(Performance::OBJECT_COUNT);
+	f.nodes = perf->get_monitor(Performance::OBJECT_NODE_COUNT);
+
+	head.store(h+1,std::memory_order_release);
+}
+
+void FrameRecorder::_drain() {
+
+	uint32_t t = tail.load(std::memory_order_relaxed);
+	uint32_t h = head.load(std::memory_order_acquire);
+	while(t!=h) {
+
+		const Frame &f = ring[t&(RING_SIZE-1)];
+		file->store_32(f.frame);
+		file->store_float(f.delta);
+		file->store_float(f.process_time);
+		file->store_float(f.physics_time);
+		file->store_32(f.draw_calls);
+		file->store_32(f.objects);
+		file->store_32(f.nodes);
+		t++;
+		tail.store(t,std::memory_order_release);
+	}
+}
+
+void FrameRecorder::_thread_func(void *p_userdata) {
+
+	FrameRecorder *recorder = (FrameRecorder*)p_userdata;
+	while(recorder->running) {
+		recorder->_drain();
+		OS::get_singleton()->delay_usec(10000);
+	}
+	recorder->_drain();
+}
@@ -0,0 +1,63 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <core/object.h>
+#include <core/os/thread.h>
+#include <core/os/file_access.h>
+#include <atomic>
+
+// Samples per-frame timings of the running game into a fixed-size
+// single-producer/single-consumer ring which a thread streams to disk.
+// The main thread never allocates nor locks while recording.
+class FrameRecorder : public Object
+{
+	OBJ_TYPE(FrameRecorder, Object);
+public:
+	struct Frame {
+		uint32_t frame;
+		float delta;
+		float process_time;
+		float physics_time;
+		uint32_t draw_calls;
+		uint32_t objects;
+		uint32_t nodes;
+	};
+
+	enum {
+		RING_SIZE=4096, // power of two
+		FILE_VERSION=1,
+		FRAME_BYTES=28
+	};
+
+private:
+	Frame ring[RING_SIZE];
+	std::atomic<uint32_t> head; // written by the main thread
+	std::atomic<uint32_t> tail; // written by the writer thread
+	std::atomic<bool> running;
+	uint32_t frame_count;
+	uint32_t dropped;
+
+	FileAccess *file;
+	Thread *thread;
+
+	static void _thread_func(void *p_userdata);
+	void _drain();
+
+protected:
+	static void _bind_methods();
+
+public:
+	void _idle_frame();
+	void _tree_exiting();
+
+	Error start(const String& p_path);
+	void stop();
+	bool is_recording() const { return thread!=NULL; }
+	int get_recorded_frames() const { return frame_count; }
+	int get_dropped_frames() const { return dropped; }
+
+	FrameRecorder();
+	~FrameRecorder();
+};
+
+#endif // FRAME_RECORDER_H
@@ -1,10 +1,31 @@
 #include "register_types.h"
 #include "scene_tree_manager.h"
+#include "frame_recorder.h"
+#include "smoke_runner.h"
+#include "scene_instancer.h"
+#include "release_fetcher.h"
+#include "resource_profiler.h"
+#include "shared_resource_cache.h"
+
+static SharedResourceCache *shared_resource_cache=NULL;
+static ResourceLoadProfiler *resource_load_profiler=NULL;
 
 void register_scene_tree_manager_types() {
 	ObjectTypeDB::register_type<SceneTreeManager>();
+	ObjectTypeDB::register_type<FrameRecorder>();
+	ObjectTypeDB::register_type<SmokeRunner>();
+	ObjectTypeDB::register_type<SceneInstancer>();
+	ObjectTypeDB::register_type<ReleaseFetcher>();
+
+	// the profiler goes in front of the shared cache so cache hits are profiled
+	shared_resource_cache = memnew(SharedResourceCache);
+	ResourceLoader::add_resource_format_loader(shared_resource_cache,true);
+	resource_load_profiler = memnew(ResourceLoadProfiler);
+	ResourceLoader::add_resource_format_loader(resource_load_profiler,true);
 }
 
 void unregister_scene_tree_manager_types() {
-
+	SceneTreeManager::cleanup();
+	memdelete(resource_load_profiler);
+	memdelete(shared_resource_cache);
 }
@@ -0,0 +1,374 @@
+#include "release_fetcher.h"
+#include <core/io/http_client.h>
+#include <core/os/os.h>
+#include <core/os/dir_access.h>
+#include <core/globals.h>
+#include <core/error_macros.h>
+#include <core/print_string.h>
+
+static bool _parse_url(const String& p_url, String& r_host, int& r_port, bool& r_ssl, String& r_path) {
+
+	String url = p_url;
+	r_ssl = false;
+	r_port = 80;
+	if (url.begins_with("https://")) {
+		r_ssl = true;
+		r_port = 443;
+		url = url.substr(8,url.length()-8);
+	} else if (url.begins_with("http://")) {
+		url = url.substr(7,url.length()-7);
+	} else
+		return false;
+
+	int slash = url.find("/");
+	if (slash==-1) {
+		r_host = url;
+		r_path = "/";
+	} else {
+		r_host = url.substr(0,slash);
+		r_path = url.substr(slash,url.length()-slash);
+	}
+
+	int colon = r_host.find(":");
+	if (colon!=-1) {
+		r_port = r_host.substr(colon+1,r_host.length()-colon-1).to_int();
+		r_host = r_host.substr(0,colon);
+	}
+	return r_host!="";
+}
+
+ReleaseFetcher::ReleaseFetcher():Object() {
+
+	poll_interval_usec=0;
+	max_bytes_per_sec=0;
+	thread=NULL;
+	mutex=Mutex::create();
+	running=false;
+	downloaded=0;
+	total=0;
+}
+
+ReleaseFetcher::~ReleaseFetcher() {
+
+	stop();
+	memdelete(mutex);
+}
+
+Error ReleaseFetcher::start(const String& p_endpoint, const String& p_current_version, float p_poll_interval_sec, int p_max_bytes_per_sec) {
+
+	ERR_EXPLAIN("Release fetcher is already running");
+	ERR_FAIL_COND_V(thread, ERR_ALREADY_IN_USE);
+	String host,path;
+	int port;
+	bool ssl;
+	ERR_EXPLAIN("Invalid release endpoint: "+p_endpoint);
+	ERR_FAIL_COND_V(!_parse_url(p_endpoint,host,port,ssl,path), ERR_INVALID_PARAMETER);
+
+	// load_project() reads the staged pack through the filesystem, not user://
+	download_dir = Globals::get_singleton()->globalize_path("user://releases");
+	DirAccess *da = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+	Error err = da->make_dir_recursive(download_dir);
+	memdelete(da);
+	if (err!=OK && err!=ERR_ALREADY_EXISTS)
+		return err;
+
+	endpoint = p_endpoint;
+	poll_interval_usec = uint64_t(MAX(p_poll_interval_sec,1.0)*1000000.0);
+	max_bytes_per_sec = p_max_bytes_per_sec;
+	current_version = p_current_version;
+	running = true;
+	thread = Thread::create(_thread_func,this);
+	return OK;
+}
+
+void ReleaseFetcher::stop() {
+
+	if (!thread)
+		return;
+	running = false;
+	Thread::wait_to_finish(thread);
+	memdelete(thread);
+	thread = NULL;
+}
+
+bool ReleaseFetcher::has_staged() const {
+
+	mutex->lock();
+	bool staged = staged_path!="";
+	mutex->unlock();
+	return staged;
+}
+
+String ReleaseFetcher::get_staged(String& r_version) const {
+
+	mutex->lock();
+	String path = staged_path;
+	r_version = staged_version;
+	mutex->unlock();
+	return path;
+}
+
+// The staged pack is running, it stays staged until then so a failed swap
+// keeps it and the poller doesn't fetch the same version again
+void ReleaseFetcher::finish_staged(const String& p_version) {
+
+	mutex->lock();
+	current_version = p_version;
+	if (staged_version==p_version) {
+		staged_path = String();
+		staged_version = String();
+	}
+	mutex->unlock();
+}
+
+Dictionary ReleaseFetcher::get_status() const {
+
+	Dictionary d;
+	mutex->lock();
+	d["running"] = thread!=NULL;
+	d["current_version"] = current_version;
+	d["staged_version"] = staged_version;
+	d["staged_path"] = staged_path;
+	d["downloading_version"] = downloading_version;
+	d["downloaded"] = double(downloaded);
+	d["total"] = double(total);
+	d["error"] = last_error;
+	mutex->unlock();
+	return d;
+}
+
+void ReleaseFetcher::_set_error(const String& p_error) {
+
+	mutex->lock();
+	last_error = p_error;
+	mutex->unlock();
+}
+
+// sleep in short steps so stop() doesn't wait for a whole poll interval
+void ReleaseFetcher::_sleep(uint64_t p_usec) {
+
+	uint64_t end = OS::get_singleton()->get_ticks_usec()+p_usec;
+	while(running && OS::get_singleton()->get_ticks_usec()<end)
+		OS::get_singleton()->delay_usec(50000);
+}
+
+void ReleaseFetcher::_thread_func(void *p_userdata) {
+
+	ReleaseFetcher *fetcher = (ReleaseFetcher*)p_userdata;
+	while(fetcher->running) {
+		fetcher->_poll();
+		fetcher->_sleep(fetcher->poll_interval_usec);
+	}
+}
+
+// Streams the response body into p_file or r_body, throttled to max_bytes_per_sec
+Error ReleaseFetcher::_http_get(const String& p_url, const Vector<String>& p_headers, int& r_code, FileAccess *p_file, String *r_body) {
+
+	String host,path;
+	int port;
+	bool ssl;
+	if (!_parse_url(p_url,host,port,ssl,path))
+		return ERR_INVALID_PARAMETER;
+
+	Ref<HTTPClient> http = memnew(HTTPClient);
+	http->set_blocking_mode(true);
+	Error err = http->connect(host,port,ssl);
+	if (err!=OK)
+		return err;
+	while(http->get_status()==HTTPClient::STATUS_RESOLVING || http->get_status()==HTTPClient::STATUS_CONNECTING) {
+		http->poll();
+		OS::get_singleton()->delay_usec(1000);
+	}
+	if (http->get_status()!=HTTPClient::STATUS_CONNECTED)
+		return ERR_CANT_CONNECT;
+
+	err = http->request(HTTPClient::METHOD_GET,path,p_headers);
+	if (err!=OK)
+		return err;
+	while(http->get_status()==HTTPClient::STATUS_REQUESTING) {
+		http->poll();
+		OS::get_singleton()->delay_usec(1000);
+	}
+	if (!http->has_response())
+		return ERR_CONNECTION_ERROR;
+
+	r_code = http->get_response_code();
+	if (p_file) {
+		if (r_code==200)
+			p_file->seek(0); // whole content instead of the requested range
+		else if (r_code!=206)
+			return OK;
+	}
+
+	Vector<uint8_t> body;
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	uint64_t received = 0;
+	while(running && http->get_status()==HTTPClient::STATUS_BODY) {
+
+		http->poll();
+		ByteArray chunk = http->read_response_body_chunk();
+		if (chunk.size()==0)
+			continue;
+
+		ByteArray::Read r = chunk.read();
+		if (p_file)
+			p_file->store_buffer(r.ptr(),chunk.size());
+		else if (r_body) {
+			int from = body.size();
+			body.resize(from+chunk.size());
+			copymem(&body[from],r.ptr(),chunk.size());
+		}
+		received += chunk.size();
+
+		if (max_bytes_per_sec>0) {
+			uint64_t expected = received*1000000/max_bytes_per_sec;
+			uint64_t elapsed = OS::get_singleton()->get_ticks_usec()-begin;
+			if (expected>elapsed)
+				OS::get_singleton()->delay_usec(expected-elapsed);
+		}
+	}
+	if (!running)
+		return ERR_SKIP;
+
+	if (r_body) {
+		body.push_back(0);
+		r_body->parse_utf8((const char*)body.ptr());
+	}
+	return OK;
+}
+
+// Resumes from the length of p_path, one range request per chunk
+Error ReleaseFetcher::_download(const String& p_url, const String& p_path, uint64_t p_size) {
+
+	Error err;
+	FileAccess *f = FileAccess::open(p_path,FileAccess::READ_WRITE,&err);
+	if (!f)
+		f = FileAccess::open(p_path,FileAccess::WRITE,&err);
+	if (!f)
+		return err;
+	f->seek_end();
+	uint64_t offset = f->get_len();
+	if (offset>p_size) {
+		// stale partial download of another pack
+		memdelete(f);
+		f = FileAccess::open(p_path,FileAccess::WRITE,&err);
+		if (!f)
+			return err;
+		offset = 0;
+	}
+
+	int retries=0;
+	while(running && offset<p_size) {
+
+		mutex->lock();
+		downloaded = offset;
+		mutex->unlock();
+
+		uint64_t last = MIN(offset+CHUNK_SIZE,p_size)-1;
+		Vector<String> headers;
+		headers.push_back("Range: bytes="+itos(offset)+"-"+itos(last));
+		int code=0;
+		err = _http_get(p_url,headers,code,f,NULL);
+		if (err==ERR_SKIP)
+			break;
+		if (err==OK && code==200) {
+			// the server ignores ranges and sent the whole pack
+			offset = f->get_len();
+			break;
+		}
+		if (err==OK && code!=206) {
+			err = ERR_CANT_OPEN;
+			break;
+		}
+
+		uint64_t previous = offset;
+		offset = f->get_len();
+		if (err==OK && offset>previous) {
+			retries=0;
+			continue;
+		}
+		// dropped connection or empty range, back off before asking again
+		if (++retries>MAX_RETRIES) {
+			if (err==OK)
+				err = ERR_CONNECTION_ERROR;
+			break;
+		}
+		err = OK;
+		_sleep(uint64_t(1000000)<<(retries-1));
+	}
+
+	memdelete(f);
+	mutex->lock();
+	downloaded = offset;
+	mutex->unlock();
+	if (err!=OK)
+		return err;
+	return offset==p_size ? OK : ERR_FILE_CORRUPT;
+}
+
+void ReleaseFetcher::_poll() {
+
+	int code=0;
+	String body;
+	Error err = _http_get(endpoint,Vector<String>(),code,NULL,&body);
+	if (err!=OK || code!=200) {
+		_set_error("Can't fetch release manifest from "+endpoint);
+		return;
+	}
+
+	Dictionary manifest;
+	if (manifest.parse_json(body)!=OK || !manifest.has("version") || !manifest.has("url") || !manifest.has("size")) {
+		_set_error("Invalid release manifest from "+endpoint);
+		return;
+	}
+
+	String version = manifest["version"];
+	mutex->lock();
+	bool known = version==current_version || version==staged_version;
+	mutex->unlock();
+	if (known)
+		return;
+
+	String url = manifest["url"];
+	if (!url.begins_with("http://") && !url.begins_with("https://"))
+		url = endpoint.get_base_dir()+"/"+url;
+	// JSON numbers are doubles, an int would wrap above 2 GB
+	uint64_t size = uint64_t(MAX(double(manifest["size"]),0.0));
+	String pack_path = download_dir+"/"+version.replace("/","_").replace("\\","_").replace(":","_")+".pck";
+	String part_path = pack_path+".part";
+
+	mutex->lock();
+	downloading_version = version;
+	total = size;
+	mutex->unlock();
+
+	err = _download(url,part_path,size);
+	if (err==OK && manifest.has("md5") && FileAccess::get_md5(part_path)!=String(manifest["md5"]).to_lower()) {
+		// corrupted, start over on the next poll
+		DirAccess *da = DirAccess::create_for_path(part_path);
+		da->remove(part_path);
+		memdelete(da);
+		err = ERR_FILE_CORRUPT;
+	}
+
+	if (err==OK) {
+		DirAccess *da = DirAccess::create_for_path(pack_path);
+		if (da->file_exists(pack_path))
+			da->remove(pack_path);
+		err = da->rename(part_path,pack_path);
+		memdelete(da);
+	}
+
+	mutex->lock();
+	downloading_version = String();
+	if (err==OK) {
+		staged_version = version;
+		staged_path = pack_path;
+		last_error = String();
+	} else if (err!=ERR_SKIP)
+		last_error = "Failed downloading release "+version;
+	mutex->unlock();
+
+	if (err==OK)
+		print_line("Release "+version+" staged at "+pack_path);
+}
@@ -0,0 +1,67 @@
+#ifndef RELEASE_FETCHER_H
+#define RELEASE_FETCHER_H
+
+#include <core/object.h>
+#include <core/os/thread.h>
+#include <core/os/mutex.h>
+#include <core/os/file_access.h>
+#include <atomic>
+
+// Polls an HTTP endpoint for the manifest of the latest game pack and
+// downloads new packs in the background. Packs are fetched in resumable
+// ranges written straight to disk and staged once verified, the game is
+// swapped when it reaches a safe point.
+//
+// The manifest is a JSON dictionary:
+//   { "version": "1.0.2", "url": "game-1.0.2.pck", "size": 123456, "md5": "..." }
+// where "url" may be relative to the endpoint and "md5" is optional.
+class ReleaseFetcher : public Object
+{
+	OBJ_TYPE(ReleaseFetcher, Object);
+public:
+	enum {
+		CHUNK_SIZE=1024*1024,
+		MAX_RETRIES=5 // per chunk, waiting 1, 2, 4... seconds in between
+	};
+
+private:
+	String endpoint;
+	String download_dir;
+	uint64_t poll_interval_usec;
+	int max_bytes_per_sec;
+
+	Thread *thread;
+	Mutex *mutex;
+	std::atomic<bool> running;
+
+	// guarded by mutex
+	String current_version;
+	String staged_version;
+	String staged_path;
+	String downloading_version;
+	uint64_t downloaded;
+	uint64_t total;
+	String last_error;
+
+	static void _thread_func(void *p_userdata);
+	void _poll();
+	Error _http_get(const String& p_url, const Vector<String>& p_headers, int& r_code, FileAccess *p_file, String *r_body);
+	Error _download(const String& p_url, const String& p_path, uint64_t p_size);
+	void _set_error(const String& p_error);
+	void _sleep(uint64_t p_usec);
+
+public:
+	Error start(const String& p_endpoint, const String& p_current_version, float p_poll_interval_sec, int p_max_bytes_per_sec);
+	void stop();
+	bool is_running() const { return thread!=NULL; }
+
+	bool has_staged() const;
+	String get_staged(String& r_version) const;
+	void finish_staged(const String& p_version);
+	Dictionary get_status() const;
+
+	ReleaseFetcher();
+	~ReleaseFetcher();
+};
+
+#endif // RELEASE_FETCHER_H
@@ -0,0 +1,203 @@
+#include "resource_profiler.h"
+#include <core/os/os.h>
+#include <core/os/file_access.h>
+#include <core/resource.h>
+
+ResourceLoadProfiler *ResourceLoadProfiler::singleton=NULL;
+
+ResourceLoadProfiler::ResourceLoadProfiler() {
+
+	singleton=this;
+	enabled=false;
+	main_thread=0;
+	root="runtime";
+}
+
+void ResourceLoadProfiler::set_enabled(bool p_enabled) {
+
+	enabled=p_enabled;
+	main_thread=Thread::get_caller_ID();
+}
+
+void ResourceLoadProfiler::get_recognized_extensions(List<String> *p_extensions) const {
+
+}
+
+bool ResourceLoadProfiler::recognize(const String& p_extension) const {
+
+	return enabled;
+}
+
+bool ResourceLoadProfiler::handles_type(const String& p_type) const {
+
+	return enabled;
+}
+
+String ResourceLoadProfiler::get_resource_type(const String &p_path) const {
+
+	return "";
+}
+
+// Interactive loads are left to the other loaders, the default implementation
+// would load the whole resource through load() in the first poll
+Ref<ResourceInteractiveLoader> ResourceLoadProfiler::load_interactive(const String &p_path,Error *r_error) {
+
+	if (r_error)
+		*r_error=ERR_FILE_UNRECOGNIZED;
+	return Ref<ResourceInteractiveLoader>();
+}
+
+RES ResourceLoadProfiler::load(const String &p_path,const String& p_original_path,Error *r_error) {
+
+	String path = p_original_path!="" ? p_original_path : p_path;
+	// not profiled, or already being profiled and handed to the other loaders
+	if (!enabled || Thread::get_caller_ID()!=main_thread || passthrough.has(path)) {
+		if (r_error)
+			*r_error=ERR_FILE_UNRECOGNIZED;
+		return RES();
+	}
+
+	Record rec;
+	rec.path=path;
+	rec.extension=path.extension().to_lower();
+	rec.requester=stack.empty() ? root : records[stack[stack.size()-1]].path;
+	rec.root=root;
+	rec.usec=0;
+	rec.self_usec=0;
+	rec.cache_hit=false;
+	rec.bytes=0;
+	FileAccess *f = FileAccess::open(p_path,FileAccess::READ);
+	if (f) {
+		rec.bytes=f->get_len();
+		memdelete(f);
+	}
+	int idx = records.size();
+	records.push_back(rec);
+
+	passthrough.insert(path);
+	stack.push_back(idx);
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	Error err;
+	// not cached here, the outer ResourceLoader::load caches the result
+	RES res = ResourceLoader::load(path,"",true,&err);
+	uint64_t usec = OS::get_singleton()->get_ticks_usec()-begin;
+	stack.resize(stack.size()-1);
+	passthrough.erase(path);
+
+	Record &done = records[idx];
+	done.usec=usec;
+	done.self_usec+=usec; // children subtracted their time already
+	if (res.is_valid())
+		done.type=res->get_type();
+	if (!stack.empty())
+		records[stack[stack.size()-1]].self_usec-=usec;
+
+	if (r_error)
+		*r_error=err;
+	return res;
+}
+
+void ResourceLoadProfiler::record_cache_hit(const String& p_path) {
+
+	if (!enabled)
+		return;
+	Record rec;
+	rec.path=p_path;
+	rec.extension=p_path.extension().to_lower();
+	rec.requester=root;
+	rec.root=root;
+	rec.usec=0;
+	rec.self_usec=0;
+	rec.bytes=0;
+	rec.cache_hit=true;
+	if (ResourceCache::has(p_path))
+		rec.type=ResourceCache::get(p_path)->get_type();
+	records.push_back(rec);
+}
+
+void ResourceLoadProfiler::clear() {
+
+	records.clear();
+	stack.clear();
+}
+
+Dictionary ResourceLoadProfiler::_to_dict(const Record& p_record) const {
+
+	Dictionary d;
+	d["path"]=p_record.path;
+	d["type"]=p_record.type;
+	d["extension"]=p_record.extension;
+	d["requester"]=p_record.requester;
+	d["root"]=p_record.root;
+	d["msec"]=p_record.usec/1000.0;
+	d["self_msec"]=p_record.self_usec/1000.0;
+	d["bytes"]=double(p_record.bytes); // GDScript ints are 32 bit
+	d["cache_hit"]=p_record.cache_hit;
+	return d;
+}
+
+Array ResourceLoadProfiler::get_records() const {
+
+	Array ret;
+	for(int i=0;i<records.size();i++)
+		ret.push_back(_to_dict(records[i]));
+	return ret;
+}
+
+struct _RecordSelfTimeSort {
+	bool operator()(const ResourceLoadProfiler::Record& a, const ResourceLoadProfiler::Record& b) const {
+		return a.self_usec > b.self_usec;
+	}
+};
+
+struct _RecordBytesSort {
+	bool operator()(const ResourceLoadProfiler::Record& a, const ResourceLoadProfiler::Record& b) const {
+		return a.bytes > b.bytes;
+	}
+};
+
+Array ResourceLoadProfiler::get_slowest(int p_count) const {
+
+	Vector<Record> sorted = records;
+	sorted.sort_custom<_RecordSelfTimeSort>();
+	Array ret;
+	for(int i=0;i<sorted.size() && i<p_count;i++)
+		ret.push_back(_to_dict(sorted[i]));
+	return ret;
+}
+
+Array ResourceLoadProfiler::get_largest(int p_count) const {
+
+	Vector<Record> sorted = records;
+	sorted.sort_custom<_RecordBytesSort>();
+	Array ret;
+	for(int i=0;i<sorted.size() && i<p_count;i++)
+		ret.push_back(_to_dict(sorted[i]));
+	return ret;
+}
+
+// Load time and bytes of every root including all the resources it depends on
+Dictionary ResourceLoadProfiler::get_root_totals() const {
+
+	Dictionary totals;
+	for(int i=0;i<records.size();i++) {
+
+		const Record &rec = records[i];
+		Dictionary d;
+		if (totals.has(rec.root))
+			d = totals[rec.root];
+		else {
+			d["msec"]=0.0;
+			d["bytes"]=0.0;
+			d["count"]=0;
+			d["cache_hits"]=0;
+		}
+		d["msec"]=double(d["msec"])+rec.self_usec/1000.0;
+		d["bytes"]=double(d["bytes"])+double(rec.bytes);
+		d["count"]=int(d["count"])+1;
+		if (rec.cache_hit)
+			d["cache_hits"]=int(d["cache_hits"])+1;
+		totals[rec.root]=d;
+	}
+	return totals;
+}
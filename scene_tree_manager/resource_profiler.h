@@ -0,0 +1,63 @@
+#ifndef RESOURCE_PROFILER_H
+#define RESOURCE_PROFILER_H
+
+#include <core/io/resource_loader.h>
+#include <core/os/thread.h>
+#include <core/vector.h>
+#include <core/set.h>
+
+// Resource loader placed in front of all others which times every load
+// made on the main thread and hands the actual loading to the other loaders.
+// Loads are attributed to the resource that requested them and to the root
+// being loaded (an autoload or the main scene).
+class ResourceLoadProfiler : public ResourceFormatLoader {
+public:
+	struct Record {
+		String path;
+		String type;
+		String extension;
+		String requester;
+		String root;
+		uint64_t usec;
+		uint64_t self_usec;
+		uint64_t bytes;
+		bool cache_hit;
+	};
+
+private:
+	static ResourceLoadProfiler *singleton;
+
+	bool enabled;
+	Thread::ID main_thread;
+	Vector<Record> records;
+	Vector<int> stack; // records being loaded
+	Set<String> passthrough;
+	String root;
+
+	Dictionary _to_dict(const Record& p_record) const;
+
+public:
+	static ResourceLoadProfiler *get_singleton() { return singleton; }
+
+	virtual Ref<ResourceInteractiveLoader> load_interactive(const String &p_path,Error *r_error=NULL);
+	virtual RES load(const String &p_path,const String& p_original_path="",Error *r_error=NULL);
+	virtual void get_recognized_extensions(List<String> *p_extensions) const;
+	virtual bool recognize(const String& p_extension) const;
+	virtual bool handles_type(const String& p_type) const;
+	virtual String get_resource_type(const String &p_path) const;
+
+	void set_enabled(bool p_enabled);
+	bool is_enabled() const { return enabled; }
+	void set_root(const String& p_root) { root=p_root; }
+	void record_cache_hit(const String& p_path);
+	void clear();
+
+	Array get_records() const;
+	Array get_slowest(int p_count) const;
+	Array get_largest(int p_count) const;
+	Dictionary get_root_totals() const;
+
+	ResourceLoadProfiler();
+};
+
+#endif // RESOURCE_PROFILER_H
@@ -0,0 +1,241 @@
+#include "scene_instancer.h"
+#include <scene/main/scene_main_loop.h>
+#include <scene/main/viewport.h>
+#include <core/os/os.h>
+#include <core/error_macros.h>
+#include <core/core_string_names.h>
+#include <core/script_language.h>
+#include <core/pair.h>
+
+SceneInstancer::SceneInstancer():Object() {
+
+	next_node=0;
+	next_connection=0;
+	budget_usec=0;
+	finished=NULL;
+}
+
+SceneInstancer::~SceneInstancer() {
+
+	cancel();
+}
+
+void SceneInstancer::_bind_methods() {
+	ObjectTypeDB::bind_method(_MD("_idle_frame"), &SceneInstancer::_idle_frame);
+	ObjectTypeDB::bind_method(_MD("_tree_exiting"), &SceneInstancer::_tree_exiting);
+}
+
+// Scene inheritance, placeholders and resources local to the scene are only
+// handled by PackedScene::instance()
+bool SceneInstancer::can_instance(const Ref<PackedScene>& p_scene) {
+
+	if (p_scene.is_null())
+		return false;
+	Ref<SceneState> state = p_scene->get_state();
+	if (state.is_null() || state->get_node_count()==0 || state->get_base_scene_state().is_valid())
+		return false;
+
+	for(int i=0;i<state->get_node_count();i++) {
+
+		if (state->is_node_instance_placeholder(i))
+			return false;
+		for(int j=0;j<state->get_node_property_count(i);j++) {
+			Variant value = state->get_node_property_value(i,j);
+			if (value.get_type()!=Variant::OBJECT)
+				continue;
+			RES res = value;
+			if (res.is_valid() && res->is_local_to_scene())
+				return false;
+		}
+	}
+	return true;
+}
+
+Error SceneInstancer::start(const Ref<PackedScene>& p_scene, int p_budget_msec, FinishedCallback p_finished) {
+
+	ERR_FAIL_COND_V(!can_instance(p_scene), ERR_INVALID_PARAMETER);
+	cancel();
+
+	scene = p_scene;
+	state = p_scene->get_state();
+	nodes.resize(state->get_node_count());
+	for(int i=0;i<nodes.size();i++)
+		nodes[i]=NULL;
+	next_node=0;
+	next_connection=0;
+	budget_usec = uint64_t(MAX(p_budget_msec,1))*1000;
+	finished = p_finished;
+	SceneTree::get_singleton()->connect("idle_frame",this,"_idle_frame");
+	// the scene tree is gone by the time the module is unregistered
+	SceneTree::get_singleton()->get_root()->connect("exit_tree",this,"_tree_exiting");
+	return OK;
+}
+
+void SceneInstancer::_disconnect() {
+
+	SceneTree *scenetree = SceneTree::get_singleton();
+	if (scenetree && scenetree->is_connected("idle_frame",this,"_idle_frame"))
+		scenetree->disconnect("idle_frame",this,"_idle_frame");
+	if (scenetree && scenetree->get_root()->is_connected("exit_tree",this,"_tree_exiting"))
+		scenetree->get_root()->disconnect("exit_tree",this,"_tree_exiting");
+}
+
+void SceneInstancer::_tree_exiting() {
+
+	cancel();
+}
+
+void SceneInstancer::cancel() {
+
+	if (state.is_null())
+		return;
+
+	_disconnect();
+
+	// the tree is not inside the scene tree yet, freeing the root frees it all
+	if (nodes.size() && nodes[0])
+		memdelete(nodes[0]);
+	nodes.clear();
+	state=Ref<SceneState>();
+	scene=Ref<PackedScene>();
+}
+
+Node *SceneInstancer::_get_node(const NodePath& p_path) const {
+
+	if (!nodes[0])
+		return NULL;
+	if (p_path==NodePath("."))
+		return nodes[0];
+	return nodes[0]->get_node(p_path);
+}
+
+bool SceneInstancer::_instance_node(int p_idx) {
+
+	Node *parent = p_idx>0 ? _get_node(state->get_node_path(p_idx,true)) : NULL;
+	if (p_idx>0 && !parent) {
+		// below a node which was skipped
+		WARN_PRINT(String("Parent of node "+String(state->get_node_name(p_idx))+" not found, skipped").utf8().get_data());
+		return true;
+	}
+
+	Node *node=NULL;
+	bool created=true;
+	Ref<PackedScene> sub_scene = state->get_node_instance(p_idx);
+	StringName type = state->get_node_type(p_idx);
+
+	if (sub_scene.is_valid()) {
+		node = sub_scene->instance();
+	} else if (type!=StringName()) {
+		Object *obj = ObjectTypeDB::instance(type);
+		node = obj ? obj->cast_to<Node>() : NULL;
+		if (!node) {
+			if (obj)
+				memdelete(obj);
+			ERR_PRINT(String("Can't instance node of type "+String(type)+", using Node").utf8().get_data());
+			node = memnew(Node);
+		}
+	} else if (parent) {
+		// node which comes from a scene instanced into an ancestor
+		NodePath path = NodePath(String(state->get_node_name(p_idx)));
+		if (!parent->has_node(path)) {
+			// removed from that scene since, skipped like SceneState::instance() does
+			WARN_PRINT(String("Node "+String(state->get_node_name(p_idx))+" is no longer in its instanced scene, skipped").utf8().get_data());
+			return true;
+		}
+		node = parent->get_node(path);
+		created=false;
+	}
+	ERR_FAIL_COND_V(!node, false);
+
+	for(int i=0;i<state->get_node_property_count(p_idx);i++) {
+		StringName name = state->get_node_property_name(p_idx,i);
+		if (name!=CoreStringNames::get_singleton()->_script) {
+			node->set(name,state->get_node_property_value(p_idx,i));
+			continue;
+		}
+		// keep the script variables set by the instanced scene across the new
+		// script, as SceneState::instance() does (godot#2958)
+		List<Pair<StringName,Variant> > old_state;
+		if (node->get_script_instance())
+			node->get_script_instance()->get_property_state(old_state);
+		node->set(name,state->get_node_property_value(p_idx,i));
+		for(List<Pair<StringName,Variant> >::Element *E=old_state.front();E;E=E->next())
+			node->set(E->get().first,E->get().second);
+	}
+
+	Vector<StringName> groups = state->get_node_groups(p_idx);
+	for(int i=0;i<groups.size();i++)
+		node->add_to_group(groups[i],true);
+
+	if (created) {
+		node->set_name(state->get_node_name(p_idx));
+		if (parent)
+			parent->add_child(node);
+	}
+	nodes[p_idx]=node;
+
+	if (created && p_idx>0) {
+		Node *owner = _get_node(state->get_node_owner_path(p_idx));
+		if (owner)
+			node->set_owner(owner);
+	}
+	return true;
+}
+
+void SceneInstancer::_connect(int p_idx) {
+
+	Node *from = _get_node(state->get_connection_source(p_idx));
+	Node *to = _get_node(state->get_connection_target(p_idx));
+	if (!from || !to)
+		return;
+
+	Array binds = state->get_connection_binds(p_idx);
+	Vector<Variant> bind_values;
+	for(int i=0;i<binds.size();i++)
+		bind_values.push_back(binds[i]);
+	from->connect(state->get_connection_signal(p_idx),to,state->get_connection_method(p_idx),bind_values,state->get_connection_flags(p_idx));
+}
+
+bool SceneInstancer::step() {
+
+	ERR_FAIL_COND_V(state.is_null(), true);
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+
+	while(next_node<nodes.size()) {
+		if (!_instance_node(next_node)) {
+			ERR_PRINT(String("Failed instancing node "+itos(next_node)+" of "+scene->get_path()).utf8().get_data());
+			FinishedCallback callback = finished;
+			cancel();
+			if (callback)
+				callback(NULL);
+			return true;
+		}
+		next_node++;
+		if (OS::get_singleton()->get_ticks_usec()-begin>=budget_usec)
+			return false;
+	}
+
+	while(next_connection<state->get_connection_count()) {
+		_connect(next_connection++);
+		if (OS::get_singleton()->get_ticks_usec()-begin>=budget_usec)
+			return false;
+	}
+	return true;
+}
+
+void SceneInstancer::_idle_frame() {
+
+	if (!step() || state.is_null())
+		return;
+
+	_disconnect();
+	Node *root = nodes[0];
+	root->set_filename(scene->get_path());
+	root->notification(Node::NOTIFICATION_INSTANCED);
+	nodes.clear();
+	state=Ref<SceneState>();
+	scene=Ref<PackedScene>();
+
+	if (finished)
+		finished(root);
+}
@@ -0,0 +1,49 @@
+#ifndef SCENE_INSTANCER_H
+#define SCENE_INSTANCER_H
+
+#include <core/object.h>
+#include <core/vector.h>
+#include <scene/resources/packed_scene.h>
+
+// Builds the node tree of a packed scene over several idle frames, spending
+// at most a given time per frame. The tree stays out of the scene tree until
+// it's complete and is then handed to the finished callback in one piece.
+class SceneInstancer : public Object
+{
+	OBJ_TYPE(SceneInstancer, Object);
+public:
+	typedef void (*FinishedCallback)(Node *p_scene); // NULL if a node failed
+
+private:
+	Ref<PackedScene> scene;
+	Ref<SceneState> state;
+	Vector<Node*> nodes;
+	int next_node;
+	int next_connection;
+	uint64_t budget_usec;
+	FinishedCallback finished;
+
+	Node *_get_node(const NodePath& p_path) const;
+	bool _instance_node(int p_idx);
+	void _connect(int p_idx);
+
+protected:
+	static void _bind_methods();
+
+	void _disconnect();
+
+public:
+	void _idle_frame();
+	void _tree_exiting();
+
+	static bool can_instance(const Ref<PackedScene>& p_scene);
+	Error start(const Ref<PackedScene>& p_scene, int p_budget_msec, FinishedCallback p_finished);
+	bool step();
+	void cancel();
+	bool is_running() const { return state.is_valid(); }
+
+	SceneInstancer();
+	~SceneInstancer();
+};
+
+#endif // SCENE_INSTANCER_H
@@ -1,4 +1,11 @@
 #include "scene_tree_manager.h"
+#include "frame_recorder.h"
+#include "smoke_runner.h"
+#include "scene_instancer.h"
+#include "release_fetcher.h"
+#include "resource_profiler.h"
+#include "session_snapshot.h"
+#include "shared_resource_cache.h"
 #include <scene/main/scene_main_loop.h>
 #include <core/translation.h>
 #include <core/os/os.h>
@@ -19,9 +26,607 @@
 #include <core/translation.h>
 #include <core/io/marshalls.h>
 #include <core/globals.h>
+#include <core/map.h>
+#include <core/set.h>
+#include <scene/resources/texture.h>
+#include <scene/gui/label.h>
+
+#if defined(WINDOWS_ENABLED)
+#include <windows.h>
+#ifndef PSAPI_VERSION
+#define PSAPI_VERSION 2 // GetProcessMemoryInfo from kernel32, no psapi.lib
+#endif
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(UNIX_ENABLED)
+#include <stdio.h>
+#include <unistd.h>
+#endif
 
 static Variant _decode_variant(const String& p_string);
 
+// The launcher's settings and scene are kept here while a game is running so
+// return_to_launcher() can switch back without restarting the process.
+// They are static as every caller creates its own SceneTreeManager instance.
+struct LauncherSnapshot {
+	bool valid;
+	Map<String,Variant> globals;
+	Set<String> persisting;
+	OS::VideoMode video_mode;
+	bool use_vsync;
+	OS::ScreenOrientation orientation;
+	bool print_error_enabled;
+	bool print_line_enabled;
+	ObjectID scene_id;
+	Node *scene; // detached launcher scene, NULL while it is still in the tree
+	bool evicted; // scene was freed to meet the memory budget
+
+	void clear() {
+		valid=false;
+		globals.clear();
+		persisting.clear();
+		scene_id=0;
+		scene=NULL;
+		evicted=false;
+	}
+
+	LauncherSnapshot() { clear(); }
+};
+
+static LauncherSnapshot launcher;
+static List<ObjectID> game_autoloads;
+
+// Memory attributed to each project passed to load_project
+struct MemorySample {
+	uint64_t static_mem;
+	uint64_t dynamic_mem;
+	uint64_t process_mem;
+};
+
+struct ProjectMemory {
+	struct Phase {
+		String name;
+		int64_t static_delta;
+		int64_t dynamic_delta;
+		int64_t process_delta;
+	};
+	Vector<Phase> phases;
+	uint64_t resource_bytes;
+	int resource_count;
+	Array offenders;
+
+	ProjectMemory() { resource_bytes=0; resource_count=0; }
+};
+
+static FrameRecorder *frame_recorder=NULL;
+static SmokeRunner *smoke_runner=NULL;
+static SceneInstancer *scene_instancer=NULL;
+static ReleaseFetcher *release_fetcher=NULL;
+static bool incremental_instancing=false;
+static int instancing_budget_msec=8;
+static Error instancing_error=OK;
+static Ref<PackedScene> loading_scene;
+
+// Settings as loaded by load_project, snapshots save what differs from them
+static Map<String,Variant> loaded_globals;
+
+static Map<String,ProjectMemory> project_memory;
+static String current_project;
+static uint64_t memory_budget=0;
+
+// Resident memory of the process, 0 where it can't be queried
+static uint64_t _process_memory_usage() {
+
+#if defined(WINDOWS_ENABLED)
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(),&pmc,sizeof(pmc)))
+		return pmc.WorkingSetSize;
+	return 0;
+#elif defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(),MACH_TASK_BASIC_INFO,(task_info_t)&info,&count)==KERN_SUCCESS)
+		return info.resident_size;
+	return 0;
+#elif defined(UNIX_ENABLED)
+	FILE *f = fopen("/proc/self/statm","r");
+	if (!f)
+		return 0;
+	unsigned long size=0, resident=0;
+	int fields = fscanf(f,"%lu %lu",&size,&resident);
+	fclose(f);
+	if (fields!=2)
+		return 0;
+	return uint64_t(resident)*sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+// The engine only counts its allocations in builds with DEBUG_MEMORY_ENABLED,
+// release players rely on the process measure
+static MemorySample _memory_sample() {
+
+	MemorySample sample;
+	sample.static_mem = OS::get_singleton()->get_static_memory_usage();
+	sample.dynamic_mem = OS::get_singleton()->get_dynamic_memory_usage();
+	sample.process_mem = _process_memory_usage();
+	return sample;
+}
+
+static uint64_t _memory_used(const MemorySample& p_sample) {
+
+	if (p_sample.process_mem)
+		return p_sample.process_mem;
+	return p_sample.static_mem+p_sample.dynamic_mem;
+}
+
+// Record usage since r_since as a phase of the current project and restart the measure
+static void _memory_phase(const String& p_name, MemorySample& r_since) {
+
+	MemorySample now = _memory_sample();
+	ProjectMemory::Phase phase;
+	phase.name = p_name;
+	phase.static_delta = int64_t(now.static_mem)-int64_t(r_since.static_mem);
+	phase.dynamic_delta = int64_t(now.dynamic_mem)-int64_t(r_since.dynamic_mem);
+	phase.process_delta = int64_t(now.process_mem)-int64_t(r_since.process_mem);
+	project_memory[current_project].phases.push_back(phase);
+	r_since = now;
+}
+
+static uint64_t _estimate_resource_bytes(const RES& p_res) {
+
+	Ref<Texture> tex = p_res;
+	if (tex.is_valid())
+		return uint64_t(tex->get_width())*tex->get_height()*4;
+
+	// built-in resources are accounted within their owner file
+	String path = p_res->get_path();
+	if (path.empty() || path.find("::")!=-1)
+		return 0;
+	FileAccess *f = FileAccess::open(path,FileAccess::READ);
+	if (!f)
+		return 0;
+	uint64_t len = f->get_len();
+	memdelete(f);
+	return len;
+}
+
+struct _ResourceBytesSort {
+	bool operator()(const Dictionary& a, const Dictionary& b) const {
+		return double(a["bytes"]) > double(b["bytes"]);
+	}
+};
+
+static void _account_cached_resources() {
+
+	ProjectMemory &pm = project_memory[current_project];
+	pm.resource_bytes=0;
+	pm.resource_count=0;
+
+	List<Ref<Resource> > cached;
+	ResourceCache::get_cached_resources(&cached);
+	for(List<Ref<Resource> >::Element *E=cached.front();E;E=E->next()) {
+		pm.resource_bytes+=_estimate_resource_bytes(E->get());
+		pm.resource_count++;
+	}
+}
+
+// Drop what the player keeps warm for later and report the largest resources
+// of the current project which make up for the excess
+static void _enforce_memory_budget() {
+
+	if (memory_budget==0)
+		return;
+	uint64_t used = _memory_used(_memory_sample());
+	ProjectMemory &pm = project_memory[current_project];
+	pm.offenders.clear();
+	if (used<=memory_budget)
+		return;
+
+	if (launcher.valid && launcher.scene) {
+		// a launcher detached from the tree can't be queued for deletion
+		if (launcher.scene->is_inside_tree())
+			launcher.scene->queue_delete();
+		else
+			memdelete(launcher.scene);
+		launcher.scene=NULL;
+		launcher.evicted=true;
+	}
+	if (SharedResourceCache::get_singleton())
+		SharedResourceCache::get_singleton()->evict(0);
+
+	Vector<Dictionary> sizes;
+	List<Ref<Resource> > cached;
+	ResourceCache::get_cached_resources(&cached);
+	for(List<Ref<Resource> >::Element *E=cached.front();E;E=E->next()) {
+		Dictionary d;
+		d["path"]=E->get()->get_path();
+		d["type"]=E->get()->get_type();
+		d["bytes"]=double(_estimate_resource_bytes(E->get()));
+		sizes.push_back(d);
+	}
+	sizes.sort_custom<_ResourceBytesSort>();
+
+	uint64_t excess = used-memory_budget;
+	uint64_t covered = 0;
+	for(int i=0;i<sizes.size() && covered<excess;i++) {
+		uint64_t bytes = double(sizes[i]["bytes"]);
+		covered+=bytes;
+		pm.offenders.push_back(sizes[i]);
+		WARN_PRINT(String("Over memory budget: "+String(sizes[i]["path"])+" ("+String::num_int64(bytes)+" bytes)").utf8().get_data());
+	}
+}
+
+// Display settings requested by the loaded project. Only the differences with
+// the live window state are applied so games sharing the launcher's display
+// settings switch without reconfiguring the window or the context.
+struct DisplayState {
+	OS::VideoMode video_mode;
+	bool use_vsync;
+	OS::ScreenOrientation orientation;
+	SceneTree::StretchMode stretch_mode;
+	SceneTree::StretchAspect stretch_aspect;
+	Size2i stretch_size;
+	String icon;
+	Color clear_color;
+	String title;
+};
+
+static DisplayState display_requested;
+static bool display_requested_set=false;
+static String applied_icon; // the OS can't tell which icon is set
+static bool display_initialized=false;
+
+// Without a project loaded, restart_scene_tree keeps the window as it is
+static void _seed_display_requested() {
+
+	OS *os = OS::get_singleton();
+	display_requested.video_mode = os->get_video_mode();
+	display_requested.video_mode.fullscreen = os->is_window_fullscreen();
+	display_requested.video_mode.resizable = os->is_window_resizable();
+	display_requested.video_mode.borderless_window = os->get_borderless_window();
+	display_requested.use_vsync = os->is_vsync_enabled();
+	display_requested.orientation = os->get_screen_orientation();
+	display_requested.icon = GLOBAL_DEF("application/icon",String());
+	display_requested.clear_color = GLOBAL_DEF("render/default_clear_color",Color(0.3,0.3,0.3));
+	// the icon was set by the engine at startup
+	applied_icon = display_requested.icon;
+	display_initialized = true;
+	display_requested_set = true;
+}
+
+static bool _same_video_mode(const OS::VideoMode& a, const OS::VideoMode& b) {
+
+	return a.width==b.width && a.height==b.height && a.fullscreen==b.fullscreen &&
+			a.resizable==b.resizable && a.borderless_window==b.borderless_window;
+}
+
+static void _request_screen_stretch() {
+
+	String stretch_mode = GLOBAL_DEF("display/stretch_mode","disabled");
+	String stretch_aspect = GLOBAL_DEF("display/stretch_aspect","ignore");
+	Size2i stretch_size = Size2(GLOBAL_DEF("display/width",0),GLOBAL_DEF("display/height",0));
+
+	SceneTree::StretchMode sml_sm=SceneTree::STRETCH_MODE_DISABLED;
+	if (stretch_mode=="2d")
+		sml_sm=SceneTree::STRETCH_MODE_2D;
+	else if (stretch_mode=="viewport")
+		sml_sm=SceneTree::STRETCH_MODE_VIEWPORT;
+
+	SceneTree::StretchAspect sml_aspect=SceneTree::STRETCH_ASPECT_IGNORE;
+	if (stretch_aspect=="keep")
+		sml_aspect=SceneTree::STRETCH_ASPECT_KEEP;
+	else if (stretch_aspect=="keep_width")
+		sml_aspect=SceneTree::STRETCH_ASPECT_KEEP_WIDTH;
+	else if (stretch_aspect=="keep_height")
+		sml_aspect=SceneTree::STRETCH_ASPECT_KEEP_HEIGHT;
+
+	display_requested.stretch_mode=sml_sm;
+	display_requested.stretch_aspect=sml_aspect;
+	display_requested.stretch_size=stretch_size;
+}
+
+static void _apply_display(SceneTree *p_scenetree) {
+
+	if (!display_requested_set)
+		_seed_display_requested();
+	OS *os = OS::get_singleton();
+	const DisplayState &req = display_requested;
+
+	// games change the window at runtime, so compare with what the OS reports
+	// rather than with what was applied for the previous game
+	if (!_same_video_mode(os->get_video_mode(),req.video_mode))
+		os->set_video_mode(req.video_mode);
+	if (os->is_window_fullscreen()!=req.video_mode.fullscreen)
+		os->set_window_fullscreen(req.video_mode.fullscreen);
+	if (os->is_window_resizable()!=req.video_mode.resizable)
+		os->set_window_resizable(req.video_mode.resizable);
+	if (os->get_borderless_window()!=req.video_mode.borderless_window)
+		os->set_borderless_window(req.video_mode.borderless_window);
+	if (os->is_vsync_enabled()!=req.use_vsync)
+		os->set_use_vsync(req.use_vsync);
+	if (os->get_screen_orientation()!=req.orientation)
+		os->set_screen_orientation(req.orientation);
+	if (req.stretch_size!=Size2i() && !req.video_mode.fullscreen && Size2i(os->get_window_size())!=req.stretch_size)
+		os->set_window_size(req.stretch_size);
+
+	// cheap to set and without getters, the game may have changed them too
+	p_scenetree->set_screen_stretch(req.stretch_mode,req.stretch_aspect,req.stretch_size);
+	VisualServer::get_singleton()->set_default_clear_color(req.clear_color);
+	os->set_window_title(req.title);
+
+	if (!display_initialized || applied_icon!=req.icon) {
+		Image icon;
+		if (req.icon!="")
+			icon.load(req.icon);
+		os->set_icon(icon);
+		applied_icon = req.icon;
+	}
+	display_initialized=true;
+}
+
+// Map the files of a project directory under res:// the way its exported pack would
+static void _remap_project_dir(const String& p_dir, const String& p_res_path="res://") {
+
+	DirAccess *da = DirAccess::open(p_dir);
+	if (!da)
+		return;
+	da->list_dir_begin();
+	String name = da->get_next();
+	while(name!="") {
+		if (name!="." && name!="..") {
+			if (da->current_is_dir())
+				_remap_project_dir(p_dir.plus_file(name),p_res_path+name+"/");
+			else
+				PathRemap::get_singleton()->add_remap(p_res_path+name,p_dir.plus_file(name));
+		}
+		name = da->get_next();
+	}
+	da->list_dir_end();
+	memdelete(da);
+}
+
+static void _free_game_autoloads() {
+
+	for(List<ObjectID>::Element *E=game_autoloads.front();E;E=E->next()) {
+		Object *obj = ObjectDB::get_instance(E->get());
+		Node *n = obj ? obj->cast_to<Node>() : NULL;
+		if (!n)
+			continue;
+		// leave the tree now so the next autoloads get the same names
+		if (n->get_parent())
+			n->get_parent()->remove_child(n);
+		n->call_deferred("free");
+	}
+	game_autoloads.clear();
+}
+
+static void _snapshot_launcher() {
+
+	Globals *globals = Globals::get_singleton();
+	launcher.clear();
+
+	List<PropertyInfo> props;
+	globals->get_property_list(&props);
+	for(List<PropertyInfo>::Element *E=props.front();E;E=E->next()) {
+
+		String name = E->get().name;
+		launcher.globals[name]=globals->get(name);
+		if (globals->is_persisting(name))
+			launcher.persisting.insert(name);
+	}
+
+	launcher.video_mode = OS::get_singleton()->get_video_mode();
+	launcher.use_vsync = OS::get_singleton()->is_vsync_enabled();
+	launcher.orientation = OS::get_singleton()->get_screen_orientation();
+	launcher.print_error_enabled = _print_error_enabled;
+	launcher.print_line_enabled = _print_line_enabled;
+
+	Node *curscene = SceneTree::get_singleton()->get_current_scene();
+	if (curscene)
+		launcher.scene_id = curscene->get_instance_ID();
+	launcher.valid=true;
+}
+
+// Only settings which differ from the launcher snapshot are written back
+static void _restore_launcher_globals() {
+
+	Globals *globals = Globals::get_singleton();
+
+	List<PropertyInfo> props;
+	globals->get_property_list(&props);
+	for(List<PropertyInfo>::Element *E=props.front();E;E=E->next()) {
+
+		if (!launcher.globals.has(E->get().name))
+			globals->clear(E->get().name);
+	}
+
+	for(Map<String,Variant>::Element *E=launcher.globals.front();E;E=E->next()) {
+
+		if (!globals->has(E->key()) || !(globals->get(E->key())==E->get()))
+			globals->set(E->key(),E->get());
+		globals->set_persisting(E->key(),launcher.persisting.has(E->key()));
+	}
+}
+
+static void _restore_launcher_display() {
+
+	OS *os = OS::get_singleton();
+	os->set_iterations_per_second(GLOBAL_DEF("physics/fixed_fps",60));
+	os->set_target_fps(GLOBAL_DEF("debug/force_fps",0));
+	os->set_frame_delay(GLOBAL_DEF("application/frame_delay_msec",0));
+
+	display_requested.video_mode = launcher.video_mode;
+	display_requested.use_vsync = launcher.use_vsync;
+	display_requested.orientation = launcher.orientation;
+	display_requested.icon = GLOBAL_DEF("application/icon",String());
+	display_requested.clear_color = GLOBAL_DEF("render/default_clear_color",Color(0.3,0.3,0.3));
+	display_requested_set = true;
+	_request_screen_stretch();
+}
+
+static MemorySample instancing_mem;
+
+// Attribute the following loads to p_root in the resource profile
+static void _profile_root(const String& p_root, const String& p_path=String()) {
+
+	ResourceLoadProfiler *profiler = ResourceLoadProfiler::get_singleton();
+	if (!profiler || !profiler->is_enabled())
+		return;
+	profiler->set_root(p_root);
+	if (p_path!="" && ResourceCache::has(p_path))
+		profiler->record_cache_hit(p_path);
+}
+
+// Custom cursor and touch emulation of the current settings, both are reset
+// when unset so the previous game's don't stay
+static void _apply_cursor_and_touch(const String& p_profile_root) {
+
+	InputDefault *id = Input::get_singleton() ? Input::get_singleton()->cast_to<InputDefault>() : NULL;
+	if (!id)
+		return;
+	//only if no touchscreen ui hint, set emulation
+	id->set_emulate_touch(bool(GLOBAL_DEF("display/emulate_touchscreen",false)) && !OS::get_singleton()->has_touchscreen_ui_hint());
+
+	String cursor_path = GLOBAL_DEF("display/custom_mouse_cursor",String());
+	Vector2 hotspot = GLOBAL_DEF("display/custom_mouse_cursor_hotspot",Vector2());
+	Ref<Texture> cursor;
+	if (cursor_path!="") {
+		_profile_root(p_profile_root,cursor_path);
+		cursor=ResourceLoader::load(cursor_path);
+		_profile_root("runtime");
+	}
+	id->set_custom_mouse_cursor(cursor,hotspot);
+}
+
+static void _replace_current_scene(Node *p_scene) {
+
+	SceneTree * scenetree = SceneTree::get_singleton();
+	Node *curscene = scenetree->get_current_scene();
+	if(curscene) {
+		if (launcher.valid && !launcher.scene && curscene->get_instance_ID()==launcher.scene_id) {
+			// keep the launcher resident but out of the tree
+			scenetree->get_root()->call_deferred("remove_child",curscene);
+			launcher.scene=curscene;
+		}
+		else
+			curscene->queue_delete();
+	}
+
+	scenetree->add_current_scene(p_scene);
+}
+
+static void _swap_current_scene(Node *p_scene, MemorySample& r_mem) {
+
+	_replace_current_scene(p_scene);
+	_memory_phase("scene_swap",r_mem);
+	_enforce_memory_budget();
+}
+
+// Shown while the main scene is instanced over several frames
+static Node *_make_loading_screen() {
+
+	if (loading_scene.is_valid()) {
+		Node *n = loading_scene->instance();
+		if (n)
+			return n;
+	}
+	Label *label = memnew(Label);
+	label->set_name("Loading");
+	label->set_text("Loading...");
+	label->set_align(Label::ALIGN_CENTER);
+	label->set_valign(Label::VALIGN_CENTER);
+	label->set_area_as_parent_rect();
+	return label;
+}
+
+static void _scene_instanced(Node *p_scene) {
+
+	if (!p_scene) {
+		// the loading screen stays current, without the autoloads of the failed game
+		instancing_error=FAILED;
+		_free_game_autoloads();
+		ERR_PRINT("Failed instancing the main scene, autoloads of the game are freed");
+		return;
+	}
+	_memory_phase("main_scene_instance",instancing_mem);
+	_swap_current_scene(p_scene,instancing_mem);
+}
+
+static String _localize_main_scene(const String& p_game_path) {
+
+	String local_game_path=p_game_path.replace("\\","/");
+	if (!local_game_path.begins_with("res://")) {
+		bool absolute=(local_game_path.size()>1) && (local_game_path[0]=='/' || local_game_path[1]==':');
+
+		if (!absolute) {
+
+			if (Globals::get_singleton()->is_using_datapack()) {
+
+				local_game_path="res://"+local_game_path;
+
+			} else {
+				int sep=local_game_path.find_last("/");
+
+				if (sep==-1) {
+					DirAccess *da = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+					local_game_path=da->get_current_dir()+"/"+local_game_path;
+					memdelete(da);
+				} else {
+
+					DirAccess *da = DirAccess::open(local_game_path.substr(0,sep));
+					if (da) {
+						local_game_path=da->get_current_dir()+"/"+local_game_path.substr(sep+1,local_game_path.length());;
+						memdelete(da);
+					}
+				}
+			}
+
+		}
+	}
+	local_game_path=Globals::get_singleton()->localize_path(local_game_path);
+	return local_game_path;
+}
+
+// Loads and instances the main scene and swaps it in, at once or over several
+// frames with incremental instancing
+static Error _start_main_scene(const String& p_path, MemorySample& r_mem) {
+
+	if (scene_instancer)
+		scene_instancer->cancel();
+	instancing_error=OK;
+	_profile_root("main_scene",p_path);
+
+	Node *scene=NULL;
+	Ref<PackedScene> scenedata = ResourceLoader::load(p_path);
+	_memory_phase("main_scene_load",r_mem);
+	_profile_root("runtime");
+
+	if (incremental_instancing && SceneInstancer::can_instance(scenedata)) {
+		if (!scene_instancer)
+			scene_instancer = memnew(SceneInstancer);
+		instancing_mem = r_mem;
+		Error err = scene_instancer->start(scenedata,instancing_budget_msec,_scene_instanced);
+		// the previous scene would keep running against the autoloads of the
+		// new game, a loading screen takes its place until the new one is complete
+		if (err==OK)
+			_replace_current_scene(_make_loading_screen());
+		return err;
+	}
+
+	if (scenedata.is_valid())
+		scene=scenedata->instance();
+	_memory_phase("main_scene_instance",r_mem);
+
+	ERR_EXPLAIN("Failed loading scene: "+p_path);
+	ERR_FAIL_COND_V(!scene, FAILED);
+
+	_swap_current_scene(scene,r_mem);
+	return OK;
+}
+
 SceneTreeManager::SceneTreeManager():Reference() {
 
 }
@@ -29,6 +634,468 @@ SceneTreeManager::SceneTreeManager():Reference() {
 void SceneTreeManager::_bind_methods() {
 	ObjectTypeDB::bind_method(_MD("restart_scene_tree"), &SceneTreeManager::restart_scene_tree);
 	ObjectTypeDB::bind_method(_MD("load_project", "path"), &SceneTreeManager::load_project);
+	ObjectTypeDB::bind_method(_MD("return_to_launcher"), &SceneTreeManager::return_to_launcher);
+	ObjectTypeDB::bind_method(_MD("has_launcher_snapshot"), &SceneTreeManager::has_launcher_snapshot);
+	ObjectTypeDB::bind_method(_MD("get_memory_report"), &SceneTreeManager::get_memory_report);
+	ObjectTypeDB::bind_method(_MD("set_memory_budget", "bytes"), &SceneTreeManager::set_memory_budget);
+	ObjectTypeDB::bind_method(_MD("get_memory_budget"), &SceneTreeManager::get_memory_budget);
+	ObjectTypeDB::bind_method(_MD("start_frame_recording", "path"), &SceneTreeManager::start_frame_recording);
+	ObjectTypeDB::bind_method(_MD("stop_frame_recording"), &SceneTreeManager::stop_frame_recording);
+	ObjectTypeDB::bind_method(_MD("is_frame_recording"), &SceneTreeManager::is_frame_recording);
+	ObjectTypeDB::bind_method(_MD("get_dropped_frames"), &SceneTreeManager::get_dropped_frames);
+	ObjectTypeDB::bind_method(_MD("run_smoke_test", "list_path", "results_path", "frames", "timeout_sec", "quit"), &SceneTreeManager::run_smoke_test, DEFVAL(300), DEFVAL(60.0), DEFVAL(true));
+	ObjectTypeDB::bind_method(_MD("set_incremental_instancing", "enabled", "budget_msec", "loading_scene"), &SceneTreeManager::set_incremental_instancing, DEFVAL(8), DEFVAL(""));
+	ObjectTypeDB::bind_method(_MD("is_incremental_instancing"), &SceneTreeManager::is_incremental_instancing);
+	ObjectTypeDB::bind_method(_MD("is_instancing_scene"), &SceneTreeManager::is_instancing_scene);
+	ObjectTypeDB::bind_method(_MD("get_instancing_error"), &SceneTreeManager::get_instancing_error);
+	ObjectTypeDB::bind_method(_MD("start_release_fetcher", "endpoint", "current_version", "poll_interval_sec", "max_bytes_per_sec"), &SceneTreeManager::start_release_fetcher, DEFVAL(60.0), DEFVAL(0));
+	ObjectTypeDB::bind_method(_MD("stop_release_fetcher"), &SceneTreeManager::stop_release_fetcher);
+	ObjectTypeDB::bind_method(_MD("get_release_status"), &SceneTreeManager::get_release_status);
+	ObjectTypeDB::bind_method(_MD("has_staged_release"), &SceneTreeManager::has_staged_release);
+	ObjectTypeDB::bind_method(_MD("release_safe_point"), &SceneTreeManager::release_safe_point);
+	ObjectTypeDB::bind_method(_MD("set_resource_profiling", "enabled"), &SceneTreeManager::set_resource_profiling);
+	ObjectTypeDB::bind_method(_MD("is_resource_profiling"), &SceneTreeManager::is_resource_profiling);
+	ObjectTypeDB::bind_method(_MD("clear_resource_profile"), &SceneTreeManager::clear_resource_profile);
+	ObjectTypeDB::bind_method(_MD("get_resource_profile"), &SceneTreeManager::get_resource_profile);
+	ObjectTypeDB::bind_method(_MD("get_slowest_resources", "count"), &SceneTreeManager::get_slowest_resources, DEFVAL(10));
+	ObjectTypeDB::bind_method(_MD("get_largest_resources", "count"), &SceneTreeManager::get_largest_resources, DEFVAL(10));
+	ObjectTypeDB::bind_method(_MD("get_resource_load_totals"), &SceneTreeManager::get_resource_load_totals);
+	ObjectTypeDB::bind_method(_MD("save_snapshot", "path"), &SceneTreeManager::save_snapshot);
+	ObjectTypeDB::bind_method(_MD("is_snapshot_pending"), &SceneTreeManager::is_snapshot_pending);
+	ObjectTypeDB::bind_method(_MD("get_snapshot_error"), &SceneTreeManager::get_snapshot_error);
+	ObjectTypeDB::bind_method(_MD("resume_snapshot", "path"), &SceneTreeManager::resume_snapshot);
+	ObjectTypeDB::bind_method(_MD("set_shared_resource_cache", "enabled", "budget_bytes", "use_disk", "disk_budget_bytes"), &SceneTreeManager::set_shared_resource_cache, DEFVAL(64.0*1024*1024), DEFVAL(false), DEFVAL(256.0*1024*1024));
+	ObjectTypeDB::bind_method(_MD("is_shared_resource_cache"), &SceneTreeManager::is_shared_resource_cache);
+	ObjectTypeDB::bind_method(_MD("clear_shared_resource_cache", "disk"), &SceneTreeManager::clear_shared_resource_cache, DEFVAL(false));
+	ObjectTypeDB::bind_method(_MD("get_shared_resource_cache_stats"), &SceneTreeManager::get_shared_resource_cache_stats);
+}
+
+void SceneTreeManager::cleanup() {
+
+	if (launcher.scene && ObjectDB::get_instance(launcher.scene_id))
+		memdelete(launcher.scene);
+	launcher.clear();
+	game_autoloads.clear();
+	project_memory.clear();
+	loaded_globals.clear();
+	loading_scene=Ref<PackedScene>();
+	SessionSnapshot::finish();
+	if (frame_recorder) {
+		memdelete(frame_recorder);
+		frame_recorder=NULL;
+	}
+	if (smoke_runner) {
+		memdelete(smoke_runner);
+		smoke_runner=NULL;
+	}
+	if (scene_instancer) {
+		memdelete(scene_instancer);
+		scene_instancer=NULL;
+	}
+	if (release_fetcher) {
+		memdelete(release_fetcher);
+		release_fetcher=NULL;
+	}
+}
+
+Error SceneTreeManager::start_frame_recording(const String& p_path) const {
+
+	if (!frame_recorder)
+		frame_recorder = memnew(FrameRecorder);
+	return frame_recorder->start(p_path);
+}
+
+void SceneTreeManager::stop_frame_recording() const {
+
+	if (frame_recorder)
+		frame_recorder->stop();
+}
+
+bool SceneTreeManager::is_frame_recording() const {
+
+	return frame_recorder && frame_recorder->is_recording();
+}
+
+int SceneTreeManager::get_dropped_frames() const {
+
+	return frame_recorder ? frame_recorder->get_dropped_frames() : 0;
+}
+
+Error SceneTreeManager::run_smoke_test(const String& p_list_path, const String& p_results_path, int p_frames, float p_timeout_sec, bool p_quit) const {
+
+	if (!smoke_runner)
+		smoke_runner = memnew(SmokeRunner);
+	return smoke_runner->run(p_list_path,p_results_path,p_frames,p_timeout_sec,p_quit);
+}
+
+void SceneTreeManager::set_incremental_instancing(bool p_enabled, int p_budget_msec, const String& p_loading_scene) const {
+
+	incremental_instancing = p_enabled;
+	instancing_budget_msec = p_budget_msec;
+	// loaded now, the paths of the launcher may not resolve once a game is loaded
+	loading_scene = p_loading_scene!="" ? Ref<PackedScene>(ResourceLoader::load(p_loading_scene)) : Ref<PackedScene>();
+	ERR_EXPLAIN("Can't load loading screen: "+p_loading_scene);
+	ERR_FAIL_COND(p_loading_scene!="" && loading_scene.is_null());
+}
+
+bool SceneTreeManager::is_incremental_instancing() const {
+
+	return incremental_instancing;
+}
+
+bool SceneTreeManager::is_instancing_scene() const {
+
+	return scene_instancer && scene_instancer->is_running();
+}
+
+Error SceneTreeManager::get_instancing_error() const {
+
+	return instancing_error;
+}
+
+Error SceneTreeManager::start_release_fetcher(const String& p_endpoint, const String& p_current_version, float p_poll_interval_sec, int p_max_bytes_per_sec) const {
+
+	if (!release_fetcher)
+		release_fetcher = memnew(ReleaseFetcher);
+	return release_fetcher->start(p_endpoint,p_current_version,p_poll_interval_sec,p_max_bytes_per_sec);
+}
+
+void SceneTreeManager::stop_release_fetcher() const {
+
+	if (release_fetcher)
+		release_fetcher->stop();
+}
+
+Dictionary SceneTreeManager::get_release_status() const {
+
+	return release_fetcher ? release_fetcher->get_status() : Dictionary();
+}
+
+bool SceneTreeManager::has_staged_release() const {
+
+	return release_fetcher && release_fetcher->has_staged();
+}
+
+// Called by the game when it may be replaced, swaps in a staged release if any
+Error SceneTreeManager::release_safe_point() const {
+
+	if (!has_staged_release())
+		return ERR_UNAVAILABLE;
+
+	String version;
+	String path = release_fetcher->get_staged(version);
+	Error err = load_project(path);
+	if (err==OK)
+		err = restart_scene_tree();
+	if (err==OK)
+		release_fetcher->finish_staged(version);
+	else
+		ERR_PRINT(String("Failed starting release "+version+", it stays staged").utf8().get_data());
+	return err;
+}
+
+void SceneTreeManager::set_resource_profiling(bool p_enabled) const {
+
+	ERR_FAIL_COND(!ResourceLoadProfiler::get_singleton());
+	ResourceLoadProfiler::get_singleton()->set_enabled(p_enabled);
+}
+
+bool SceneTreeManager::is_resource_profiling() const {
+
+	return ResourceLoadProfiler::get_singleton() && ResourceLoadProfiler::get_singleton()->is_enabled();
+}
+
+void SceneTreeManager::clear_resource_profile() const {
+
+	ERR_FAIL_COND(!ResourceLoadProfiler::get_singleton());
+	ResourceLoadProfiler::get_singleton()->clear();
+}
+
+Array SceneTreeManager::get_resource_profile() const {
+
+	ERR_FAIL_COND_V(!ResourceLoadProfiler::get_singleton(), Array());
+	return ResourceLoadProfiler::get_singleton()->get_records();
+}
+
+Array SceneTreeManager::get_slowest_resources(int p_count) const {
+
+	ERR_FAIL_COND_V(!ResourceLoadProfiler::get_singleton(), Array());
+	return ResourceLoadProfiler::get_singleton()->get_slowest(p_count);
+}
+
+Array SceneTreeManager::get_largest_resources(int p_count) const {
+
+	ERR_FAIL_COND_V(!ResourceLoadProfiler::get_singleton(), Array());
+	return ResourceLoadProfiler::get_singleton()->get_largest(p_count);
+}
+
+Dictionary SceneTreeManager::get_resource_load_totals() const {
+
+	ERR_FAIL_COND_V(!ResourceLoadProfiler::get_singleton(), Dictionary());
+	return ResourceLoadProfiler::get_singleton()->get_root_totals();
+}
+
+Error SceneTreeManager::save_snapshot(const String& p_path) const {
+
+	Node *scene = SceneTree::get_singleton()->get_current_scene();
+	ERR_EXPLAIN("No running scene to snapshot");
+	ERR_FAIL_COND_V(!scene || is_instancing_scene(), ERR_UNAVAILABLE);
+
+	int dropped=0;
+	Dictionary scene_data;
+	Error err = SessionSnapshot::pack_node(scene,scene_data,dropped);
+	if (err!=OK)
+		return err;
+
+	Array autoloads;
+	for(List<ObjectID>::Element *E=game_autoloads.front();E;E=E->next()) {
+		Object *obj = ObjectDB::get_instance(E->get());
+		Node *n = obj ? obj->cast_to<Node>() : NULL;
+		Dictionary data;
+		if (!n || SessionSnapshot::pack_node(n,data,dropped)!=OK)
+			continue;
+		Dictionary autoload;
+		autoload["name"]=n->get_name();
+		autoload["scene"]=data;
+		autoloads.push_back(autoload);
+	}
+
+	Globals *globals = Globals::get_singleton();
+	Dictionary overrides;
+	List<PropertyInfo> props;
+	globals->get_property_list(&props);
+	for(List<PropertyInfo>::Element *E=props.front();E;E=E->next()) {
+		String name = E->get().name;
+		Variant value = globals->get(name);
+		if (!loaded_globals.has(name) || !(loaded_globals[name]==value))
+			overrides[name]=SessionSnapshot::encode_resources(value,dropped);
+	}
+
+	if (dropped)
+		WARN_PRINT(String("Snapshot leaves out "+itos(dropped)+" resources created at runtime").utf8().get_data());
+
+	Dictionary snapshot;
+	snapshot["project"]=current_project;
+	snapshot["scene"]=scene_data;
+	snapshot["autoloads"]=autoloads;
+	snapshot["globals"]=overrides;
+	// encoded and written by a thread
+	return SessionSnapshot::write(p_path,snapshot);
+}
+
+bool SceneTreeManager::is_snapshot_pending() const {
+
+	return SessionSnapshot::is_writing();
+}
+
+Error SceneTreeManager::get_snapshot_error() const {
+
+	return SessionSnapshot::get_error();
+}
+
+Error SceneTreeManager::resume_snapshot(const String& p_path) const {
+
+	Dictionary snapshot;
+	Error err = SessionSnapshot::read(p_path,snapshot);
+	if (err!=OK)
+		return err;
+
+	String project = snapshot["project"];
+	if (project!="" && project!=current_project) {
+		// load_project replaces the remaps, folder projects get theirs back
+		err = load_project(project);
+		if (err!=OK)
+			return err;
+	}
+
+	Globals *globals = Globals::get_singleton();
+	Dictionary overrides = snapshot["globals"];
+	List<Variant> keys;
+	overrides.get_key_list(&keys);
+	for(List<Variant>::Element *E=keys.front();E;E=E->next())
+		globals->set(String(E->get()),SessionSnapshot::decode_resources(overrides[E->get()]));
+
+	SceneTree * scenetree = SceneTree::get_singleton();
+	if (scene_instancer)
+		scene_instancer->cancel();
+	_request_screen_stretch();
+	scenetree->set_auto_accept_quit(GLOBAL_DEF("application/auto_accept_quit",true));
+	String appname = globals->get("application/name");
+	display_requested.title = TranslationServer::get_singleton()->translate(appname);
+	_apply_display(scenetree);
+
+	MemorySample mem = _memory_sample();
+	_free_game_autoloads();
+
+	// singletons must exist before the scripts of the snapshot are compiled
+	Array autoloads = snapshot["autoloads"];
+	for(int i=0;i<autoloads.size();i++) {
+		String name = Dictionary(autoloads[i])["name"];
+		if (String(globals->get("autoload/"+name)).begins_with("*")) {
+			for(int j=0;j<ScriptServer::get_language_count();j++)
+				ScriptServer::get_language(j)->add_global_constant(name,Variant());
+		}
+	}
+
+	List<Node*> to_add;
+	for(int i=0;i<autoloads.size();i++) {
+		Dictionary autoload = autoloads[i];
+		String name = autoload["name"];
+		Node *n = SessionSnapshot::unpack_node(autoload["scene"]);
+		ERR_EXPLAIN("Can't resume autoload: "+name);
+		ERR_CONTINUE(!n);
+		n->set_name(name);
+		to_add.push_back(n);
+		if (String(globals->get("autoload/"+name)).begins_with("*")) {
+			for(int j=0;j<ScriptServer::get_language_count();j++)
+				ScriptServer::get_language(j)->add_global_constant(name,n);
+		}
+	}
+	for(List<Node*>::Element *E=to_add.front();E;E=E->next()) {
+		scenetree->get_root()->add_child(E->get());
+		game_autoloads.push_back(E->get()->get_instance_ID());
+	}
+	_memory_phase("autoload",mem);
+
+	Node *scene = SessionSnapshot::unpack_node(snapshot["scene"]);
+	_memory_phase("main_scene_instance",mem);
+	ERR_EXPLAIN("Can't resume scene from snapshot: "+p_path);
+	ERR_FAIL_COND_V(!scene, FAILED);
+
+	_swap_current_scene(scene,mem);
+	return OK;
+}
+
+void SceneTreeManager::set_shared_resource_cache(bool p_enabled, double p_budget_bytes, bool p_use_disk, double p_disk_budget_bytes) const {
+
+	ERR_FAIL_COND(!SharedResourceCache::get_singleton());
+	SharedResourceCache::get_singleton()->set_enabled(p_enabled,uint64_t(MAX(p_budget_bytes,0.0)),p_use_disk,uint64_t(MAX(p_disk_budget_bytes,0.0)));
+}
+
+bool SceneTreeManager::is_shared_resource_cache() const {
+
+	return SharedResourceCache::get_singleton() && SharedResourceCache::get_singleton()->is_enabled();
+}
+
+void SceneTreeManager::clear_shared_resource_cache(bool p_disk) const {
+
+	ERR_FAIL_COND(!SharedResourceCache::get_singleton());
+	SharedResourceCache::get_singleton()->clear(p_disk);
+}
+
+Dictionary SceneTreeManager::get_shared_resource_cache_stats() const {
+
+	ERR_FAIL_COND_V(!SharedResourceCache::get_singleton(), Dictionary());
+	return SharedResourceCache::get_singleton()->get_stats();
+}
+
+Dictionary SceneTreeManager::get_memory_report() const {
+
+	// opens every cached file, so it's only done when asked for
+	if (current_project!="")
+		_account_cached_resources();
+	Dictionary report;
+	for(Map<String,ProjectMemory>::Element *E=project_memory.front();E;E=E->next()) {
+
+		const ProjectMemory &pm = E->get();
+		Array phases;
+		for(int i=0;i<pm.phases.size();i++) {
+			Dictionary phase;
+			phase["name"]=pm.phases[i].name;
+			phase["static"]=double(pm.phases[i].static_delta);
+			phase["dynamic"]=double(pm.phases[i].dynamic_delta);
+			phase["process"]=double(pm.phases[i].process_delta);
+			phases.push_back(phase);
+		}
+
+		Dictionary d;
+		d["phases"]=phases;
+		d["resource_bytes"]=double(pm.resource_bytes);
+		d["resource_count"]=pm.resource_count;
+		d["offenders"]=pm.offenders;
+		report[E->key()]=d;
+	}
+	return report;
+}
+
+void SceneTreeManager::set_memory_budget(double p_bytes) const {
+
+	memory_budget = p_bytes>0 ? uint64_t(p_bytes) : 0;
+}
+
+double SceneTreeManager::get_memory_budget() const {
+
+	return double(memory_budget);
+}
+
+uint64_t SceneTreeManager::get_memory_usage() {
+
+	return _memory_used(_memory_sample());
+}
+
+bool SceneTreeManager::has_launcher_snapshot() const {
+
+	return launcher.valid;
+}
+
+Error SceneTreeManager::return_to_launcher() const {
+
+	ERR_EXPLAIN("No launcher snapshot to return to");
+	ERR_FAIL_COND_V(!launcher.valid, ERR_UNAVAILABLE);
+
+	SceneTree * scenetree = SceneTree::get_singleton();
+	Object *obj = ObjectDB::get_instance(launcher.scene_id);
+	Node *launcher_scene = obj ? obj->cast_to<Node>() : NULL;
+	bool evicted = launcher.evicted;
+	ERR_EXPLAIN("Launcher scene is no longer resident");
+	ERR_FAIL_COND_V(!launcher_scene && !evicted, ERR_UNAVAILABLE);
+	// the launcher is still current if the game failed to start
+	bool detached = launcher.scene!=NULL;
+
+	if (scene_instancer)
+		scene_instancer->cancel();
+	_free_game_autoloads();
+	Node *curscene = scenetree->get_current_scene();
+	if (curscene && curscene!=launcher_scene && !evicted)
+		curscene->queue_delete();
+
+	// Resources of the game must not be served to the launcher by path
+	ResourceCache::clear();
+
+	_restore_launcher_globals();
+	_print_error_enabled = launcher.print_error_enabled;
+	_print_line_enabled = launcher.print_line_enabled;
+
+	InputMap::get_singleton()->load_from_globals();
+	PathRemap::get_singleton()->clear_remaps();
+	PathRemap::get_singleton()->load_remaps();
+
+	_restore_launcher_display();
+	scenetree->set_auto_accept_quit(GLOBAL_DEF("application/auto_accept_quit",true));
+
+	TranslationServer::get_singleton()->clear();
+	TranslationServer::get_singleton()->load_translations();
+	_apply_cursor_and_touch("launcher");
+
+	launcher.clear();
+	current_project=String();
+
+	String appname = Globals::get_singleton()->get("application/name");
+	display_requested.title = TranslationServer::get_singleton()->translate(appname);
+	_apply_display(scenetree);
+	if (detached)
+		scenetree->add_current_scene(launcher_scene);
+
+	// a launcher evicted under memory pressure is instanced again from its main
+	// scene, its own autoloads were never freed and are not created again
+	if (evicted) {
+		String game_path = GLOBAL_DEF("application/main_scene","");
+		ERR_EXPLAIN("Launcher has no main scene to instance again");
+		ERR_FAIL_COND_V(game_path.empty(), FAILED);
+		MemorySample mem = _memory_sample();
+		return _start_main_scene(_localize_main_scene(game_path),mem);
+	}
+	return OK;
 }
 
 Error SceneTreeManager::restart_scene_tree() const {
@@ -40,67 +1107,24 @@ Error SceneTreeManager::restart_scene_tree() const {
 	}
 	else {
 
-		String stretch_mode = GLOBAL_DEF("display/stretch_mode","disabled");
-		String stretch_aspect = GLOBAL_DEF("display/stretch_aspect","ignore");
-		Size2i stretch_size = Size2(GLOBAL_DEF("display/width",0),GLOBAL_DEF("display/height",0));
-
-		SceneTree::StretchMode sml_sm=SceneTree::STRETCH_MODE_DISABLED;
-		if (stretch_mode=="2d")
-			sml_sm=SceneTree::STRETCH_MODE_2D;
-		else if (stretch_mode=="viewport")
-			sml_sm=SceneTree::STRETCH_MODE_VIEWPORT;
-
-		SceneTree::StretchAspect sml_aspect=SceneTree::STRETCH_ASPECT_IGNORE;
-		if (stretch_aspect=="keep")
-			sml_aspect=SceneTree::STRETCH_ASPECT_KEEP;
-		else if (stretch_aspect=="keep_width")
-			sml_aspect=SceneTree::STRETCH_ASPECT_KEEP_WIDTH;
-		else if (stretch_aspect=="keep_height")
-			sml_aspect=SceneTree::STRETCH_ASPECT_KEEP_HEIGHT;
-
-		scenetree->set_screen_stretch(sml_sm,sml_aspect,stretch_size);
-		if(stretch_size != Size2())
-			OS::get_singleton()->set_window_size(stretch_size);
+		_request_screen_stretch();
 
 		scenetree->set_auto_accept_quit(GLOBAL_DEF("application/auto_accept_quit",true));
 		String appname = Globals::get_singleton()->get("application/name");
-		appname = TranslationServer::get_singleton()->translate(appname);
-		OS::get_singleton()->set_window_title(appname);
+		display_requested.title = TranslationServer::get_singleton()->translate(appname);
+
+		// everything requested by load_project is applied here in one go
+		_apply_display(scenetree);
 
+		if (scene_instancer)
+			scene_instancer->cancel();
 
 		List<PropertyInfo> props;
 		Globals::get_singleton()->get_property_list(&props);
 
-		String local_game_path=game_path.replace("\\","/");
-		if (!local_game_path.begins_with("res://")) {
-			bool absolute=(local_game_path.size()>1) && (local_game_path[0]=='/' || local_game_path[1]==':');
-
-			if (!absolute) {
-
-				if (Globals::get_singleton()->is_using_datapack()) {
+		String local_game_path=_localize_main_scene(game_path);
 
-					local_game_path="res://"+local_game_path;
-
-				} else {
-					int sep=local_game_path.find_last("/");
-
-					if (sep==-1) {
-						DirAccess *da = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
-						local_game_path=da->get_current_dir()+"/"+local_game_path;
-						memdelete(da);
-					} else {
-
-						DirAccess *da = DirAccess::open(local_game_path.substr(0,sep));
-						if (da) {
-							local_game_path=da->get_current_dir()+"/"+local_game_path.substr(sep+1,local_game_path.length());;
-							memdelete(da);
-						}
-					}
-				}
-
-			}
-		}
-		local_game_path=Globals::get_singleton()->localize_path(local_game_path);
+		MemorySample mem = _memory_sample();
 
 		//first pass, add the constants so they exist before any script is loaded
 		for(List<PropertyInfo>::Element *E=props.front();E;E=E->next()) {
@@ -124,6 +1148,7 @@ Error SceneTreeManager::restart_scene_tree() const {
 		}
 
 		//second pass, load into global constants
+		_free_game_autoloads();
 		List<Node*> to_add;
 		for(List<PropertyInfo>::Element *E=props.front();E;E=E->next()) {
 
@@ -138,6 +1163,7 @@ Error SceneTreeManager::restart_scene_tree() const {
 				path=path.substr(1,path.length()-1);
 			}
 
+			_profile_root("autoload/"+name,path);
 			RES res = ResourceLoader::load(path);
 			ERR_EXPLAIN("Can't autoload: "+path);
 			ERR_CONTINUE(res.is_null());
@@ -179,31 +1205,11 @@ Error SceneTreeManager::restart_scene_tree() const {
 
 		for(List<Node*>::Element *E=to_add.front();E;E=E->next()) {
 			scenetree->get_root()->add_child(E->get());
+			game_autoloads.push_back(E->get()->get_instance_ID());
 		}
-
-		Node *scene=NULL;
-		Ref<PackedScene> scenedata = ResourceLoader::load(local_game_path);
-		if (scenedata.is_valid())
-			scene=scenedata->instance();
-
-		ERR_EXPLAIN("Failed loading scene: "+local_game_path);
-		ERR_FAIL_COND_V(!scene, FAILED);
-
-
-		String iconpath = GLOBAL_DEF("application/icon","Variant()""");
-		if (iconpath!="") {
-			Image icon;
-			if (icon.load(iconpath)==OK)
-				OS::get_singleton()->set_icon(icon);
-		}
-
-		Node *curscene = scenetree->get_current_scene();
-		if(curscene)
-			curscene->queue_delete();
-
-		scenetree->add_current_scene(scene);
+		_memory_phase("autoload",mem);
+		return _start_main_scene(local_game_path,mem);
 	}
-	return OK;
 }
 
 // Most of code below are copied from global.cpp
@@ -706,10 +1712,15 @@ static Variant _decode_variant(const String& p_string) {
 Error SceneTreeManager::load_project(const String &p_path) const {
 	Error err;
 	auto globals = Globals::get_singleton();
+
+	// nothing of the running game or launcher is touched until the project is found
+	String project_dir;
+	String cfg_path;
 	DirAccess* dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
 	FileAccess* f = FileAccess::create(FileAccess::ACCESS_FILESYSTEM);
 	if( OK == dir->change_dir(p_path)  ){
-		String cfg_path = p_path + "/engine.cfg";
+		project_dir = dir->get_current_dir();
+		cfg_path = p_path + "/engine.cfg";
 		if(!f->file_exists(cfg_path))
 			cfg_path = p_path + "/engine.cfb";
 		if(!f->file_exists(cfg_path)){
@@ -718,33 +1729,56 @@ Error SceneTreeManager::load_project(const String &p_path) const {
 			ERR_EXPLAIN("engine.cfg not found under project directory.");
 			return FAILED;
 		}
-		if(cfg_path.ends_with(".cfg"))
-			err = load_global_settings(cfg_path);
-		else if(cfg_path.ends_with(".cfb"))
-			err = load_binary_global_settings(cfg_path);
-		else
-			err = FAILED;
 	}
-	else if(f->file_exists(p_path)) {
-		if(globals->call("load_resource_pack", p_path))
-			err = load_binary_global_settings("res://engine.cfb");
-		else
-			err = FAILED;
+	else if(!f->file_exists(p_path)) {
+		memdelete(f);
+		memdelete(dir);
+		ERR_EXPLAIN("Project not found: "+p_path);
+		return FAILED;
 	}
-	else
-		err = FAILED;
-
 	memdelete(f);
 	memdelete(dir);
 
+	MemorySample mem = _memory_sample();
+	if (project_dir=="") {
+		if(!globals->call("load_resource_pack", p_path)) {
+			ERR_EXPLAIN("Can't load resource pack: "+p_path);
+			return FAILED;
+		}
+		// the shared cache takes the md5 of packed files from the pack directory
+		if (SharedResourceCache::get_singleton())
+			SharedResourceCache::get_singleton()->add_pack(p_path);
+	}
+
+	if (!launcher.valid)
+		_snapshot_launcher();
+	else if (current_project!="") {
+		// resources of the previous game are still cached for its report
+		_account_cached_resources();
+		// switching games, the settings of the previous game must not leak into this one
+		_restore_launcher_globals();
+	}
+
+	if (project_dir=="")
+		err = load_binary_global_settings("res://engine.cfb");
+	else if(cfg_path.ends_with(".cfg"))
+		err = load_global_settings(cfg_path);
+	else
+		err = load_binary_global_settings(cfg_path);
 	if (OK != err)
 		return err;
+
+	current_project = p_path;
+	project_memory[current_project]=ProjectMemory();
+	_memory_phase("settings",mem);
+
 	_print_error_enabled = bool(GLOBAL_DEF("application/disable_stderr", true));
 	_print_line_enabled  = bool(GLOBAL_DEF("application/disable_stdout", true));
 
 	//keys for game
 	InputMap *input_map = InputMap::get_singleton();
 	input_map->load_from_globals();
+	_memory_phase("input_map",mem);
 
 
 	OS::VideoMode video_mode;
@@ -776,10 +1810,10 @@ Error SceneTreeManager::load_project(const String &p_path) const {
 	GLOBAL_DEF("display/fullscreen",video_mode.fullscreen);
 	GLOBAL_DEF("display/resizable",video_mode.resizable);
 	GLOBAL_DEF("display/borderless_window", video_mode.borderless_window);
-	OS::get_singleton()->set_video_mode(video_mode);
+	// display settings are applied by restart_scene_tree
+	display_requested.video_mode = video_mode;
 
-	bool use_vsync = GLOBAL_DEF("display/use_vsync", true);
-	OS::get_singleton()->set_use_vsync(use_vsync);
+	display_requested.use_vsync = GLOBAL_DEF("display/use_vsync", true);
 
 	GLOBAL_DEF("display/test_width",0);
 	GLOBAL_DEF("display/test_height",0);
@@ -787,19 +1821,19 @@ Error SceneTreeManager::load_project(const String &p_path) const {
 		String orientation = GLOBAL_DEF("display/orientation","landscape");
 
 		if (orientation=="portrait")
-			OS::get_singleton()->set_screen_orientation(OS::SCREEN_PORTRAIT);
+			display_requested.orientation = OS::SCREEN_PORTRAIT;
 		else if (orientation=="reverse_landscape")
-			OS::get_singleton()->set_screen_orientation(OS::SCREEN_REVERSE_LANDSCAPE);
+			display_requested.orientation = OS::SCREEN_REVERSE_LANDSCAPE;
 		else if (orientation=="reverse_portrait")
-			OS::get_singleton()->set_screen_orientation(OS::SCREEN_REVERSE_PORTRAIT);
+			display_requested.orientation = OS::SCREEN_REVERSE_PORTRAIT;
 		else if (orientation=="sensor_landscape")
-			OS::get_singleton()->set_screen_orientation(OS::SCREEN_SENSOR_LANDSCAPE);
+			display_requested.orientation = OS::SCREEN_SENSOR_LANDSCAPE;
 		else if (orientation=="sensor_portrait")
-			OS::get_singleton()->set_screen_orientation(OS::SCREEN_SENSOR_PORTRAIT);
+			display_requested.orientation = OS::SCREEN_SENSOR_PORTRAIT;
 		else if (orientation=="sensor")
-			OS::get_singleton()->set_screen_orientation(OS::SCREEN_SENSOR);
+			display_requested.orientation = OS::SCREEN_SENSOR;
 		else
-			OS::get_singleton()->set_screen_orientation(OS::SCREEN_LANDSCAPE);
+			display_requested.orientation = OS::SCREEN_LANDSCAPE;
 	}
 
 
@@ -811,46 +1845,35 @@ Error SceneTreeManager::load_project(const String &p_path) const {
 		frame_delay=GLOBAL_DEF("application/frame_delay_msec",0);
 	}
 	OS::get_singleton()->set_frame_delay(frame_delay);
+	_memory_phase("display",mem);
 
-
-
+	// remaps of the previous game must not resolve paths of this one
+	PathRemap::get_singleton()->clear_remaps();
 	PathRemap::get_singleton()->load_remaps();
+	if (project_dir!="")
+		_remap_project_dir(project_dir);
+	_memory_phase("remaps",mem);
 
-	Image icon(GLOBAL_DEF("application/icon", ""));
-	OS::get_singleton()->set_icon(icon);
-
-	VisualServer::get_singleton()->set_default_clear_color(GLOBAL_DEF("render/default_clear_color",Color(0.3,0.3,0.3)));
+	display_requested.icon = GLOBAL_DEF("application/icon",String());
+	display_requested.clear_color = GLOBAL_DEF("render/default_clear_color",Color(0.3,0.3,0.3));
+	display_requested_set = true;
 
-	GLOBAL_DEF("application/icon",String());
 	Globals::get_singleton()->set_custom_property_info("application/icon",PropertyInfo(Variant::STRING,"application/icon",PROPERTY_HINT_FILE,"*.png,*.webp"));
 
-	if (bool(GLOBAL_DEF("display/emulate_touchscreen",false))) {
-		if (!OS::get_singleton()->has_touchscreen_ui_hint() && Input::get_singleton()) {
-			//only if no touchscreen ui hint, set emulation
-			InputDefault *id = Input::get_singleton()->cast_to<InputDefault>();
-			if (id)
-				id->set_emulate_touch(true);
-		}
-	}
-
-	GLOBAL_DEF("display/custom_mouse_cursor",String());
-	GLOBAL_DEF("display/custom_mouse_cursor_hotspot",Vector2());
 	Globals::get_singleton()->set_custom_property_info("display/custom_mouse_cursor",PropertyInfo(Variant::STRING,"display/custom_mouse_cursor",PROPERTY_HINT_FILE,"*.png,*.webp"));
-
-	if (String(Globals::get_singleton()->get("display/custom_mouse_cursor"))!=String()) {
-
-		//print_line("use custom cursor");
-		Ref<Texture> cursor=ResourceLoader::load(Globals::get_singleton()->get("display/custom_mouse_cursor"));
-		if (cursor.is_valid()) {
-			//	print_line("loaded ok");
-			Vector2 hotspot = Globals::get_singleton()->get("display/custom_mouse_cursor_hotspot");
-			Input::get_singleton()->set_custom_mouse_cursor(cursor,hotspot);
-		}
-	}
+	_apply_cursor_and_touch("load_project");
+	_memory_phase("icon_cursor",mem);
 
 	ScriptServer::init_languages();
 	TranslationServer::get_singleton()->clear();
 	TranslationServer::get_singleton()->load_translations();
+	_memory_phase("translations",mem);
+
+	loaded_globals.clear();
+	List<PropertyInfo> props;
+	globals->get_property_list(&props);
+	for(List<PropertyInfo>::Element *E=props.front();E;E=E->next())
+		loaded_globals[E->get().name]=globals->get(E->get().name);
 
 	return OK;
 }
@@ -15,6 +15,51 @@ public:
 	Error load_global_settings(const String &p_path) const;
 	Error load_binary_global_settings(const String &p_path) const;
 	Error load_project(const String &p_path) const;
+	Error return_to_launcher() const;
+	bool has_launcher_snapshot() const;
+
+	Dictionary get_memory_report() const;
+	void set_memory_budget(double p_bytes) const;
+	double get_memory_budget() const;
+	static uint64_t get_memory_usage();
+
+	Error start_frame_recording(const String& p_path) const;
+	void stop_frame_recording() const;
+	bool is_frame_recording() const;
+	int get_dropped_frames() const;
+
+	void set_incremental_instancing(bool p_enabled, int p_budget_msec=8, const String& p_loading_scene="") const;
+	bool is_incremental_instancing() const;
+	bool is_instancing_scene() const;
+	Error get_instancing_error() const;
+
+	Error start_release_fetcher(const String& p_endpoint, const String& p_current_version, float p_poll_interval_sec=60.0, int p_max_bytes_per_sec=0) const;
+	void stop_release_fetcher() const;
+	Dictionary get_release_status() const;
+	bool has_staged_release() const;
+	Error release_safe_point() const;
+
+	void set_resource_profiling(bool p_enabled) const;
+	bool is_resource_profiling() const;
+	void clear_resource_profile() const;
+	Array get_resource_profile() const;
+	Array get_slowest_resources(int p_count=10) const;
+	Array get_largest_resources(int p_count=10) const;
+	Dictionary get_resource_load_totals() const;
+
+	Error save_snapshot(const String& p_path) const;
+	bool is_snapshot_pending() const;
+	Error get_snapshot_error() const;
+	Error resume_snapshot(const String& p_path) const;
+
+	void set_shared_resource_cache(bool p_enabled, double p_budget_bytes=64.0*1024*1024, bool p_use_disk=false, double p_disk_budget_bytes=256.0*1024*1024) const;
+	bool is_shared_resource_cache() const;
+	void clear_shared_resource_cache(bool p_disk=false) const;
+	Dictionary get_shared_resource_cache_stats() const;
+
+	Error run_smoke_test(const String& p_list_path, const String& p_results_path, int p_frames=300, float p_timeout_sec=60.0, bool p_quit=true) const;
+
+	static void cleanup();
 
 	SceneTreeManager();
 };
@@ -0,0 +1,221 @@
+#include "session_snapshot.h"
+#include <scene/main/node.h>
+#include <scene/resources/packed_scene.h>
+#include <core/io/marshalls.h>
+#include <core/io/resource_loader.h>
+#include <core/os/file_access.h>
+#include <core/resource.h>
+#include <core/error_macros.h>
+
+Thread *SessionSnapshot::thread=NULL;
+std::atomic<bool> SessionSnapshot::writing(false);
+String SessionSnapshot::write_path;
+Error SessionSnapshot::write_error=OK;
+
+struct SnapshotWriteJob {
+	String path;
+	Dictionary data;
+};
+
+static const char *RESOURCE_KEY="__res__";
+
+Variant SessionSnapshot::encode_resources(const Variant& p_value, int& r_dropped) {
+
+	switch(p_value.get_type()) {
+
+		case Variant::OBJECT: {
+			RES res = p_value;
+			if (res.is_valid() && res->get_path()!="") {
+				// built-in resources are found again through their owner file
+				Dictionary ref;
+				ref[RESOURCE_KEY]=res->get_path();
+				return ref;
+			}
+			if (!p_value.is_zero())
+				r_dropped++;
+			return Variant();
+		} break;
+		case Variant::ARRAY: {
+			Array src = p_value;
+			Array ret;
+			for(int i=0;i<src.size();i++)
+				ret.push_back(encode_resources(src[i],r_dropped));
+			return ret;
+		} break;
+		case Variant::DICTIONARY: {
+			Dictionary src = p_value;
+			Dictionary ret;
+			List<Variant> keys;
+			src.get_key_list(&keys);
+			for(List<Variant>::Element *E=keys.front();E;E=E->next())
+				ret[encode_resources(E->get(),r_dropped)]=encode_resources(src[E->get()],r_dropped);
+			return ret;
+		} break;
+		default: {}
+	}
+	return p_value;
+}
+
+Variant SessionSnapshot::decode_resources(const Variant& p_value) {
+
+	switch(p_value.get_type()) {
+
+		case Variant::ARRAY: {
+			Array src = p_value;
+			Array ret;
+			for(int i=0;i<src.size();i++)
+				ret.push_back(decode_resources(src[i]));
+			return ret;
+		} break;
+		case Variant::DICTIONARY: {
+			Dictionary src = p_value;
+			if (src.size()==1 && src.has(RESOURCE_KEY)) {
+				String path = src[RESOURCE_KEY];
+				int sub = path.find("::");
+				if (sub!=-1 && !ResourceCache::has(path)) {
+					// loading the owner file caches its built-in resources
+					RES owner = ResourceLoader::load(path.substr(0,sub));
+					if (ResourceCache::has(path))
+						return RES(ResourceCache::get(path));
+					return Variant();
+				}
+				return ResourceLoader::load(path);
+			}
+			Dictionary ret;
+			List<Variant> keys;
+			src.get_key_list(&keys);
+			for(List<Variant>::Element *E=keys.front();E;E=E->next())
+				ret[decode_resources(E->get())]=decode_resources(src[E->get()]);
+			return ret;
+		} break;
+		default: {}
+	}
+	return p_value;
+}
+
+static void _claim_owner(Node *p_root, Node *p_node, List<Node*>& r_claimed) {
+
+	for(int i=0;i<p_node->get_child_count();i++) {
+		Node *child = p_node->get_child(i);
+		if (!child->get_owner()) {
+			child->set_owner(p_root);
+			r_claimed.push_back(child);
+		}
+		_claim_owner(p_root,child,r_claimed);
+	}
+}
+
+Error SessionSnapshot::pack_node(Node *p_node, Dictionary& r_bundled, int& r_dropped) {
+
+	ERR_FAIL_NULL_V(p_node, ERR_INVALID_PARAMETER);
+
+	// nodes added at runtime have no owner and would be left out of the pack
+	List<Node*> claimed;
+	_claim_owner(p_node,p_node,claimed);
+	Ref<PackedScene> packed = memnew(PackedScene);
+	Error err = packed->pack(p_node);
+	for(List<Node*>::Element *E=claimed.front();E;E=E->next())
+		E->get()->set_owner(NULL);
+	if (err!=OK)
+		return err;
+
+	r_bundled = encode_resources(packed->get_state()->get_bundled_scene(),r_dropped);
+	return OK;
+}
+
+Node *SessionSnapshot::unpack_node(const Dictionary& p_bundled) {
+
+	Ref<PackedScene> packed = memnew(PackedScene);
+	packed->get_state()->set_bundled_scene(decode_resources(p_bundled));
+	return packed->instance();
+}
+
+void SessionSnapshot::_write_func(void *p_userdata) {
+
+	SnapshotWriteJob *job = (SnapshotWriteJob*)p_userdata;
+	int len=0;
+	write_error = encode_variant(job->data,NULL,len);
+	if (write_error==OK) {
+
+		Vector<uint8_t> buf;
+		buf.resize(len);
+		encode_variant(job->data,buf.ptr(),len);
+
+		FileAccess *f = FileAccess::open(job->path,FileAccess::WRITE,&write_error);
+		if (f) {
+			f->store_buffer((const uint8_t*)"GPSS",4);
+			f->store_32(VERSION);
+			f->store_32(len);
+			f->store_buffer(buf.ptr(),len);
+			if (f->get_error()!=OK)
+				write_error=ERR_FILE_CANT_WRITE;
+			memdelete(f);
+		}
+	}
+	if (write_error!=OK)
+		ERR_PRINT(String("Failed writing session snapshot: "+job->path).utf8().get_data());
+	memdelete(job);
+	writing=false;
+}
+
+Error SessionSnapshot::write(const String& p_path, const Dictionary& p_snapshot) {
+
+	finish();
+	SnapshotWriteJob *job = memnew(SnapshotWriteJob);
+	job->path = p_path;
+	job->data = p_snapshot;
+	write_path = p_path;
+	write_error = OK;
+	writing = true;
+	thread = Thread::create(_write_func,job);
+	return OK;
+}
+
+Error SessionSnapshot::finish() {
+
+	if (thread) {
+		Thread::wait_to_finish(thread);
+		memdelete(thread);
+		thread=NULL;
+	}
+	return write_error;
+}
+
+Error SessionSnapshot::read(const String& p_path, Dictionary& r_snapshot) {
+
+	// the snapshot may still be on its way to the disk, or never got there
+	if (write_path==p_path) {
+		Error err = finish();
+		if (err!=OK)
+			return err;
+	}
+
+	Error err;
+	FileAccess *f = FileAccess::open(p_path,FileAccess::READ,&err);
+	if (!f)
+		return err;
+
+	uint8_t hdr[4];
+	f->get_buffer(hdr,4);
+	if (hdr[0]!='G' || hdr[1]!='P' || hdr[2]!='S' || hdr[3]!='S' || f->get_32()!=VERSION) {
+		memdelete(f);
+		ERR_EXPLAIN("Not a session snapshot: "+p_path);
+		ERR_FAIL_V(ERR_FILE_UNRECOGNIZED);
+	}
+
+	uint32_t len = f->get_32();
+	Vector<uint8_t> buf;
+	buf.resize(len);
+	bool complete = f->get_buffer(buf.ptr(),len)==len;
+	memdelete(f);
+	ERR_EXPLAIN("Truncated session snapshot: "+p_path);
+	ERR_FAIL_COND_V(!complete, ERR_FILE_CORRUPT);
+
+	Variant data;
+	err = decode_variant(data,buf.ptr(),len);
+	if (err!=OK)
+		return err;
+	ERR_FAIL_COND_V(data.get_type()!=Variant::DICTIONARY, ERR_FILE_CORRUPT);
+	r_snapshot = data;
+	return OK;
+}
@@ -0,0 +1,41 @@
+#ifndef SESSION_SNAPSHOT_H
+#define SESSION_SNAPSHOT_H
+
+#include <core/variant.h>
+#include <core/os/thread.h>
+#include <atomic>
+
+class Node;
+
+// Saves running game sessions with the engine's variant marshalling.
+// Nodes are packed with PackedScene::pack(), so the properties stored are
+// the ones a saved scene would have, script members included when exported.
+// Resources are referenced by path, resources created at runtime are dropped.
+class SessionSnapshot {
+
+	static Thread *thread;
+	static std::atomic<bool> writing;
+	static String write_path;
+	static Error write_error;
+
+	static void _write_func(void *p_userdata);
+
+public:
+	enum {
+		VERSION=1
+	};
+
+	static Error pack_node(Node *p_node, Dictionary& r_bundled, int& r_dropped);
+	static Node *unpack_node(const Dictionary& p_bundled);
+
+	static Variant encode_resources(const Variant& p_value, int& r_dropped);
+	static Variant decode_resources(const Variant& p_value);
+
+	static Error write(const String& p_path, const Dictionary& p_snapshot);
+	static Error read(const String& p_path, Dictionary& r_snapshot);
+	static bool is_writing() { return writing; }
+	static Error get_error() { return writing ? ERR_BUSY : write_error; }
+	static Error finish();
+};
+
+#endif // SESSION_SNAPSHOT_H
@@ -0,0 +1,391 @@
+#include "shared_resource_cache.h"
+#include <core/io/resource_saver.h>
+#include <core/os/file_access.h>
+#include <core/os/dir_access.h>
+#include <core/resource.h>
+#include <core/globals.h>
+#include <scene/resources/texture.h>
+
+#define DISK_CACHE_DIR "user://rescache"
+
+SharedResourceCache *SharedResourceCache::singleton=NULL;
+
+SharedResourceCache::SharedResourceCache() {
+
+	singleton=this;
+	enabled=false;
+	use_disk=false;
+	budget=0;
+	used=0;
+	disk_budget=0;
+	disk_used=0;
+	use_count=0;
+	main_thread=0;
+	hits=0;
+	disk_hits=0;
+	misses=0;
+
+	static const char *shared_extensions[]={"png","jpg","jpeg","webp","tex","fnt","font","wav","smp","ogg","oga","opus",NULL};
+	for(int i=0;shared_extensions[i];i++)
+		extensions.insert(shared_extensions[i]);
+}
+
+void SharedResourceCache::set_enabled(bool p_enabled, uint64_t p_budget, bool p_use_disk, uint64_t p_disk_budget) {
+
+	enabled=p_enabled;
+	budget=p_budget;
+	use_disk=p_use_disk;
+	disk_budget=p_disk_budget;
+	main_thread=Thread::get_caller_ID();
+
+	if (use_disk) {
+		DirAccess *da = DirAccess::create(DirAccess::ACCESS_USERDATA);
+		da->make_dir_recursive(DISK_CACHE_DIR);
+		memdelete(da);
+		// files left by previous runs count against the budget too
+		_prune_disk();
+	}
+	if (!enabled)
+		evict(0);
+	else
+		evict(budget);
+}
+
+void SharedResourceCache::get_recognized_extensions(List<String> *p_extensions) const {
+
+}
+
+bool SharedResourceCache::recognize(const String& p_extension) const {
+
+	return enabled && extensions.has(p_extension.to_lower());
+}
+
+bool SharedResourceCache::handles_type(const String& p_type) const {
+
+	return enabled;
+}
+
+String SharedResourceCache::get_resource_type(const String &p_path) const {
+
+	return "";
+}
+
+// Reads the directory of a pack mounted by load_project. Files of later packs
+// replace the ones of earlier packs, as they do in PackedData.
+void SharedResourceCache::add_pack(const String& p_pack) {
+
+	FileAccess *f = FileAccess::open(p_pack,FileAccess::READ);
+	if (!f)
+		return;
+	// packs appended to an executable are hashed when loaded instead
+	if (f->get_32()!=0x43504447) { // "GDPC"
+		memdelete(f);
+		return;
+	}
+	f->get_32(); // pack format
+	f->get_32(); // engine version
+	f->get_32();
+	f->get_32();
+	for(int i=0;i<16;i++)
+		f->get_32(); // reserved
+
+	int count = f->get_32();
+	for(int i=0;i<count && !f->eof_reached();i++) {
+
+		uint32_t slen = f->get_32();
+		CharString cs;
+		cs.resize(slen+1);
+		f->get_buffer((uint8_t*)cs.ptr(),slen);
+		cs[slen]=0;
+		String path;
+		path.parse_utf8(cs.ptr());
+
+		PackedFile pf;
+		pf.pack = p_pack;
+		pf.offset = f->get_64();
+		pf.size = f->get_64();
+		uint8_t md5[16];
+		f->get_buffer(md5,16);
+		bool stored=false;
+		for(int j=0;j<16;j++)
+			stored = stored || md5[j];
+		if (stored)
+			pf.md5 = String::md5(md5);
+		packed_files[path]=pf;
+	}
+	memdelete(f);
+}
+
+// Hash of a file, memoized while a file keeps its length and modification
+// time, or its place in the pack it comes from
+String SharedResourceCache::_file_hash(const String& p_path, uint64_t& r_len) {
+
+	String key;
+	const PackedFile *pf = packed_files.getptr(p_path);
+	if (pf) {
+		r_len = pf->size;
+		if (pf->md5!="")
+			return pf->md5;
+		key = pf->pack+":"+itos(pf->offset)+":"+itos(pf->size);
+	} else {
+		FileAccess *f = FileAccess::open(p_path,FileAccess::READ);
+		if (!f)
+			return String();
+		r_len = f->get_len();
+		memdelete(f);
+		uint64_t mtime = FileAccess::get_modified_time(p_path);
+		// files of packs not mounted by load_project have no modification time
+		if (mtime)
+			key = p_path+":"+itos(r_len)+":"+itos(mtime);
+	}
+
+	if (key!="" && hashes.has(key))
+		return hashes[key];
+	String hash = FileAccess::get_md5(p_path);
+	if (key!="" && hash!="")
+		hashes[key]=hash;
+	return hash;
+}
+
+// Hash of the file and of the import flags next to it
+String SharedResourceCache::_content_hash(const String& p_path, uint64_t& r_len) {
+
+	String hash = _file_hash(p_path,r_len);
+	if (hash=="")
+		return String();
+
+	uint64_t flags_len=0;
+	String flags_hash;
+	if (packed_files.has(p_path+".flags") || FileAccess::exists(p_path+".flags"))
+		flags_hash = _file_hash(p_path+".flags",flags_len);
+	String settings = _loader_settings(p_path.extension().to_lower());
+	if (flags_hash!="" || settings!="")
+		hash = (hash+flags_hash+settings).md5_text();
+	return hash;
+}
+
+// Project settings the image loader falls back to where the .flags file has
+// no entry. Fonts are included as they hold the textures they loaded.
+String SharedResourceCache::_loader_settings(const String& p_extension) const {
+
+	if (p_extension!="png" && p_extension!="jpg" && p_extension!="jpeg" && p_extension!="webp" && p_extension!="fnt" && p_extension!="font")
+		return String();
+
+	Globals *globals = Globals::get_singleton();
+	bool filter = globals->has("image_loader/filter") ? bool(globals->get("image_loader/filter")) : true;
+	bool mipmaps = globals->has("image_loader/gen_mipmaps") ? bool(globals->get("image_loader/gen_mipmaps")) : true;
+	bool repeat = globals->has("image_loader/repeat") ? bool(globals->get("image_loader/repeat")) : false;
+	return String("filter=")+itos(filter)+",mipmaps="+itos(mipmaps)+",repeat="+itos(repeat);
+}
+
+// A resource can't be cached under two paths of the running project at once
+bool SharedResourceCache::_can_share(const RES& p_res, const String& p_path) const {
+
+	String current = p_res->get_path();
+	if (current=="" || !ResourceCache::has(current))
+		return true;
+	return current==p_path && ResourceCache::get(current)==p_res.ptr();
+}
+
+void SharedResourceCache::_store(const String& p_hash, const RES& p_res, uint64_t p_len) {
+
+	Entry e;
+	e.resource = p_res;
+	e.bytes = p_len;
+	Ref<Texture> tex = p_res;
+	if (tex.is_valid())
+		e.bytes = uint64_t(tex->get_width())*tex->get_height()*4;
+	e.last_use = ++use_count;
+	entries[p_hash]=e;
+	used += e.bytes;
+	evict(budget);
+}
+
+RES SharedResourceCache::_load(const String& p_path, Error *r_error) {
+
+	passthrough.insert(p_path);
+	RES res = ResourceLoader::load(p_path,"",true,r_error);
+	passthrough.erase(p_path);
+	return res;
+}
+
+RES SharedResourceCache::load(const String &p_path,const String& p_original_path,Error *r_error) {
+
+	String path = p_original_path!="" ? p_original_path : p_path;
+	if (!enabled || Thread::get_caller_ID()!=main_thread || passthrough.has(path)) {
+		if (r_error)
+			*r_error=ERR_FILE_UNRECOGNIZED;
+		return RES();
+	}
+
+	uint64_t len=0;
+	String hash = _content_hash(p_path,len);
+	if (hash=="") {
+		if (r_error)
+			*r_error=ERR_FILE_UNRECOGNIZED;
+		return RES();
+	}
+
+	Entry *e = entries.getptr(hash);
+	if (e && _can_share(e->resource,path)) {
+		hits++;
+		e->last_use = ++use_count;
+		// the path left over from the previous project is not in the cache anymore
+		if (e->resource->get_path()!=path)
+			e->resource->set_path("");
+		if (r_error)
+			*r_error=OK;
+		return e->resource;
+	}
+
+	String disk_path = String(DISK_CACHE_DIR)+"/"+hash+".res";
+	if (!e && use_disk && FileAccess::exists(disk_path)) {
+		RES res = _load(disk_path,r_error);
+		if (res.is_valid()) {
+			disk_hits++;
+			_touch_disk(disk_path);
+			res->set_path("");
+			_store(hash,res,len);
+			return res;
+		}
+	}
+
+	misses++;
+	RES res = _load(path,r_error);
+	if (res.is_null() || e)
+		return res;
+	if (!res->is_type("Texture") && !res->is_type("Font") && !res->is_type("Sample") && !res->is_type("AudioStream"))
+		return res;
+
+	// streams only save the path of their source file, which belongs to the
+	// project; textures of fonts are bundled for the same reason
+	if (use_disk && (res->is_type("ImageTexture") || res->is_type("Sample") || res->is_type("Font"))) {
+		if (ResourceSaver::save(disk_path,res,ResourceSaver::FLAG_BUNDLE_RESOURCES)==OK) {
+			FileAccess *f = FileAccess::open(disk_path,FileAccess::READ);
+			if (f) {
+				disk_used += f->get_len();
+				memdelete(f);
+			}
+			if (disk_used>disk_budget)
+				_prune_disk();
+		}
+	}
+	_store(hash,res,len);
+	return res;
+}
+
+// Drops the least recently used entries, resources still used by a scene stay alive
+void SharedResourceCache::evict(uint64_t p_budget) {
+
+	while(used>p_budget && entries.size()) {
+
+		const String *oldest=NULL;
+		uint64_t oldest_use=0;
+		const String *k=NULL;
+		while((k=entries.next(k))) {
+			if (!oldest || entries[*k].last_use<oldest_use) {
+				oldest=k;
+				oldest_use=entries[*k].last_use;
+			}
+		}
+		String victim = *oldest;
+		used -= entries[victim].bytes;
+		entries.erase(victim);
+	}
+}
+
+struct _DiskCacheFile {
+	String path;
+	uint64_t modified;
+	uint64_t size;
+	bool operator<(const _DiskCacheFile& p_file) const { return modified<p_file.modified; }
+};
+
+// Measures the files on disk and removes the least recently used ones until
+// they fit in the disk budget, by modification time as they outlive the process
+void SharedResourceCache::_prune_disk() {
+
+	disk_used=0;
+	DirAccess *da = DirAccess::open(DISK_CACHE_DIR);
+	if (!da)
+		return;
+	Vector<_DiskCacheFile> files;
+	da->list_dir_begin();
+	String file = da->get_next();
+	while(file!="") {
+		if (!da->current_is_dir() && file.ends_with(".res")) {
+			_DiskCacheFile cf;
+			cf.path = String(DISK_CACHE_DIR)+"/"+file;
+			cf.modified = FileAccess::get_modified_time(cf.path);
+			cf.size = 0;
+			FileAccess *f = FileAccess::open(cf.path,FileAccess::READ);
+			if (f) {
+				cf.size = f->get_len();
+				memdelete(f);
+			}
+			disk_used += cf.size;
+			files.push_back(cf);
+		}
+		file = da->get_next();
+	}
+	da->list_dir_end();
+
+	if (disk_used>disk_budget) {
+		files.sort();
+		for(int i=0;i<files.size() && disk_used>disk_budget;i++) {
+			if (da->remove(files[i].path)==OK)
+				disk_used -= files[i].size;
+		}
+	}
+	memdelete(da);
+}
+
+// Rewrites the first byte so the modification time follows the last use
+void SharedResourceCache::_touch_disk(const String& p_path) {
+
+	FileAccess *f = FileAccess::open(p_path,FileAccess::READ_WRITE);
+	if (!f)
+		return;
+	uint8_t first = f->get_8();
+	f->seek(0);
+	f->store_8(first);
+	memdelete(f);
+}
+
+void SharedResourceCache::clear(bool p_disk) {
+
+	entries.clear();
+	hashes.clear();
+	used=0;
+	if (!p_disk)
+		return;
+
+	DirAccess *da = DirAccess::open(DISK_CACHE_DIR);
+	if (!da)
+		return;
+	da->list_dir_begin();
+	String file = da->get_next();
+	while(file!="") {
+		if (!da->current_is_dir() && file.ends_with(".res"))
+			da->remove(file);
+		file = da->get_next();
+	}
+	da->list_dir_end();
+	memdelete(da);
+	disk_used=0;
+}
+
+Dictionary SharedResourceCache::get_stats() const {
+
+	Dictionary d;
+	d["enabled"]=enabled;
+	d["entries"]=entries.size();
+	d["bytes"]=double(used);
+	d["budget"]=double(budget);
+	d["disk_bytes"]=double(disk_used);
+	d["disk_budget"]=double(disk_budget);
+	d["hits"]=hits;
+	d["disk_hits"]=disk_hits;
+	d["misses"]=misses;
+	return d;
+}
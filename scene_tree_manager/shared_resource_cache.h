@@ -0,0 +1,77 @@
+#ifndef SHARED_RESOURCE_CACHE_H
+#define SHARED_RESOURCE_CACHE_H
+
+#include <core/io/resource_loader.h>
+#include <core/os/thread.h>
+#include <core/hash_map.h>
+#include <core/set.h>
+
+// Resource loader placed in front of the others which keys textures, fonts
+// and audio by the hash of their file content, so identical files of
+// different projects resolve to the resource already loaded. Decoded
+// resources can also be kept on disk under user:// for later processes.
+class SharedResourceCache : public ResourceFormatLoader {
+
+	struct Entry {
+		RES resource;
+		uint64_t bytes;
+		uint64_t last_use;
+	};
+
+	// file of a mounted pack, md5 as stored in the pack directory
+	struct PackedFile {
+		String pack;
+		uint64_t offset;
+		uint64_t size;
+		String md5;
+	};
+
+	static SharedResourceCache *singleton;
+
+	bool enabled;
+	bool use_disk;
+	uint64_t budget;
+	uint64_t used;
+	uint64_t disk_budget;
+	uint64_t disk_used;
+	uint64_t use_count;
+	Thread::ID main_thread;
+	HashMap<String,Entry> entries;
+	HashMap<String,String> hashes; // file path, length and time (or pack and offset) to content hash
+	HashMap<String,PackedFile> packed_files;
+	Set<String> passthrough;
+	Set<String> extensions;
+
+	int hits;
+	int disk_hits;
+	int misses;
+
+	String _file_hash(const String& p_path, uint64_t& r_len);
+	String _content_hash(const String& p_path, uint64_t& r_len);
+	String _loader_settings(const String& p_extension) const;
+	bool _can_share(const RES& p_res, const String& p_path) const;
+	void _store(const String& p_hash, const RES& p_res, uint64_t p_len);
+	void _prune_disk();
+	void _touch_disk(const String& p_path);
+	RES _load(const String& p_path, Error *r_error);
+
+public:
+	static SharedResourceCache *get_singleton() { return singleton; }
+
+	virtual RES load(const String &p_path,const String& p_original_path="",Error *r_error=NULL);
+	virtual void get_recognized_extensions(List<String> *p_extensions) const;
+	virtual bool recognize(const String& p_extension) const;
+	virtual bool handles_type(const String& p_type) const;
+	virtual String get_resource_type(const String &p_path) const;
+
+	void add_pack(const String& p_pack);
+	void set_enabled(bool p_enabled, uint64_t p_budget, bool p_use_disk, uint64_t p_disk_budget);
+	bool is_enabled() const { return enabled; }
+	void evict(uint64_t p_budget);
+	void clear(bool p_disk);
+	Dictionary get_stats() const;
+
+	SharedResourceCache();
+};
+
+#endif // SHARED_RESOURCE_CACHE_H
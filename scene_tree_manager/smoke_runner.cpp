@@ -0,0 +1,179 @@
+#include "smoke_runner.h"
+#include <scene/main/scene_main_loop.h>
+#include <core/os/os.h>
+#include <core/os/file_access.h>
+#include <core/error_macros.h>
+#include <core/print_string.h>
+
+SmokeRunner::SmokeRunner():Object() {
+
+	frames=0;
+	timeout_usec=0;
+	quit_when_done=false;
+	current=-1;
+	started=false;
+	instancing=false;
+	frame=0;
+	load_begin=0;
+	load_usec=0;
+	start_ticks=0;
+	last_ticks=0;
+	first_frame_usec=0;
+	peak_memory=0;
+}
+
+void SmokeRunner::_bind_methods() {
+	ObjectTypeDB::bind_method(_MD("_idle_frame"), &SmokeRunner::_idle_frame);
+}
+
+Error SmokeRunner::run(const String& p_list_path, const String& p_results_path, int p_frames, float p_timeout_sec, bool p_quit) {
+
+	ERR_EXPLAIN("Smoke run is already in progress");
+	ERR_FAIL_COND_V(is_running(), ERR_ALREADY_IN_USE);
+
+	Error err;
+	FileAccess *f = FileAccess::open(p_list_path,FileAccess::READ,&err);
+	if (err!=OK)
+		return err;
+
+	games.clear();
+	while(!f->eof_reached()) {
+		String line = f->get_line().strip_edges();
+		if (line!="" && !line.begins_with("#"))
+			games.push_back(line);
+	}
+	memdelete(f);
+
+	ERR_EXPLAIN("No game listed in: "+p_list_path);
+	ERR_FAIL_COND_V(games.empty(), ERR_INVALID_DATA);
+
+	manager = Ref<SceneTreeManager>(memnew(SceneTreeManager));
+	results_path = p_results_path;
+	frames = MAX(p_frames,1);
+	timeout_usec = uint64_t(p_timeout_sec*1000000.0);
+	quit_when_done = p_quit;
+	results.clear();
+	current=0;
+	started=false;
+	SceneTree::get_singleton()->connect("idle_frame",this,"_idle_frame");
+	return OK;
+}
+
+void SmokeRunner::_start_game() {
+
+	const String &path = games[current];
+	print_line("Smoke run: "+path);
+
+	frame=0;
+	first_frame_usec=0;
+	frame_times.clear();
+	frame_times.resize(frames);
+
+	load_begin = OS::get_singleton()->get_ticks_usec();
+	Error err = manager->load_project(path);
+	if (err==OK)
+		err = manager->restart_scene_tree();
+	started=true;
+	// with incremental instancing the main scene is only there a few frames later
+	instancing = err==OK && manager->is_instancing_scene();
+	if (!instancing)
+		_begin_frames();
+
+	if (err!=OK)
+		_finish_game("load_failed");
+}
+
+void SmokeRunner::_begin_frames() {
+
+	start_ticks = OS::get_singleton()->get_ticks_usec();
+	last_ticks = start_ticks;
+	load_usec = start_ticks-load_begin;
+	peak_memory = SceneTreeManager::get_memory_usage();
+}
+
+void SmokeRunner::_finish_game(const String& p_status) {
+
+	Dictionary d;
+	d["path"]=games[current];
+	d["status"]=p_status;
+	d["load_msec"]=load_usec/1000.0;
+	d["first_frame_msec"]=first_frame_usec/1000.0;
+	d["frames"]=frame;
+	d["peak_memory"]=double(peak_memory);
+
+	Vector<float> sorted = frame_times;
+	sorted.resize(frame);
+	sorted.sort();
+	Dictionary pct;
+	if (frame>0) {
+		pct["p50"]=sorted[(frame-1)*50/100];
+		pct["p90"]=sorted[(frame-1)*90/100];
+		pct["p99"]=sorted[(frame-1)*99/100];
+		pct["max"]=sorted[frame-1];
+	}
+	d["frame_msec"]=pct;
+	results.push_back(d);
+
+	started=false;
+	current++;
+	if (current<games.size())
+		return;
+
+	current=-1;
+	SceneTree::get_singleton()->disconnect("idle_frame",this,"_idle_frame");
+	_write_results();
+	if (quit_when_done)
+		SceneTree::get_singleton()->quit();
+}
+
+void SmokeRunner::_write_results() {
+
+	Dictionary d;
+	d["frames"]=frames;
+	d["games"]=results;
+
+	FileAccess *f = FileAccess::open(results_path,FileAccess::WRITE);
+	ERR_EXPLAIN("Can't write smoke run results: "+results_path);
+	ERR_FAIL_COND(!f);
+	f->store_string(d.to_json());
+	memdelete(f);
+	print_line("Smoke run results written to "+results_path);
+}
+
+void SmokeRunner::_idle_frame() {
+
+	if (current<0)
+		return;
+
+	// games are loaded from an idle frame so the previous one is fully swapped out
+	if (!started) {
+		_start_game();
+		return;
+	}
+
+	if (instancing) {
+		if (manager->is_instancing_scene())
+			return;
+		instancing=false;
+		_begin_frames();
+		if (manager->get_instancing_error()!=OK)
+			_finish_game("load_failed");
+		return;
+	}
+
+	uint64_t ticks = OS::get_singleton()->get_ticks_usec();
+	if (frame==0)
+		first_frame_usec = ticks-start_ticks;
+	frame_times[frame] = (ticks-last_ticks)/1000.0;
+	last_ticks = ticks;
+	frame++;
+
+	uint64_t mem = SceneTreeManager::get_memory_usage();
+	if (mem>peak_memory)
+		peak_memory=mem;
+
+	if (frame>=frames)
+		_finish_game("ok");
+	else if (timeout_usec && ticks-start_ticks>timeout_usec)
+		_finish_game("timeout");
+}
@@ -0,0 +1,52 @@
+#ifndef SMOKE_RUNNER_H
+#define SMOKE_RUNNER_H
+
+#include <core/object.h>
+#include <core/vector.h>
+#include "scene_tree_manager.h"
+
+// Loads every game of a list one after another, advances a number of frames
+// and writes load latency, first frame time, frame time percentiles and peak
+// memory of each game into one JSON results file.
+class SmokeRunner : public Object
+{
+	OBJ_TYPE(SmokeRunner, Object);
+
+	Ref<SceneTreeManager> manager;
+	Vector<String> games;
+	String results_path;
+	int frames;
+	uint64_t timeout_usec;
+	bool quit_when_done;
+
+	int current;
+	bool started;
+	bool instancing;
+	int frame;
+	uint64_t load_begin;
+	uint64_t load_usec;
+	uint64_t start_ticks;
+	uint64_t last_ticks;
+	uint64_t first_frame_usec;
+	uint64_t peak_memory;
+	Vector<float> frame_times;
+	Array results;
+
+	void _start_game();
+	void _begin_frames();
+	void _finish_game(const String& p_status);
+	void _write_results();
+
+protected:
+	static void _bind_methods();
+
+public:
+	void _idle_frame();
+
+	Error run(const String& p_list_path, const String& p_results_path, int p_frames, float p_timeout_sec, bool p_quit);
+	bool is_running() const { return current>=0; }
+
+	SmokeRunner();
+};
+
+#endif // SMOKE_RUNNER_H
@@ -0,0 +1,95 @@
+#!/usr/bin/env node
+// Convert frame recordings written by SceneTreeManager.start_frame_recording
+// Usage:
+//   node frametrace.js --input frames.gpfr --format csv|json|summary [--output out]
+//   node frametrace.js --input old.gpfr --compare new.gpfr
+const fs = require('fs');
+const argv = require('optimist').argv;
+const log = console.log.bind(console);
+
+const FIELDS = ['frame', 'delta', 'process_time', 'physics_time', 'draw_calls', 'objects', 'nodes'];
+
+function readFrames(file) {
+  const buf = fs.readFileSync(file);
+  if(buf.length < 12 || buf.toString('ascii', 0, 4) !== 'GPFR') {
+    throw new Error(`${file} is not a frame recording`);
+  }
+  const version = buf.readUInt32LE(4);
+  const size = buf.readUInt32LE(8);
+  if(version !== 1) {
+    throw new Error(`${file}: unsupported version ${version}`);
+  }
+  const frames = [];
+  for(let pos = 12; pos + size <= buf.length; pos += size) {
+    frames.push({
+      frame: buf.readUInt32LE(pos),
+      delta: buf.readFloatLE(pos + 4),
+      process_time: buf.readFloatLE(pos + 8),
+      physics_time: buf.readFloatLE(pos + 12),
+      draw_calls: buf.readUInt32LE(pos + 16),
+      objects: buf.readUInt32LE(pos + 20),
+      nodes: buf.readUInt32LE(pos + 24),
+    });
+  }
+  return frames;
+}
+
+function percentile(sorted, p) {
+  if(!sorted.length)
+    return 0;
+  return sorted[Math.min(sorted.length - 1, Math.floor(p / 100 * sorted.length))];
+}
+
+function summary(frames) {
+  const result = { frames: frames.length };
+  for(const field of ['delta', 'process_time', 'physics_time', 'draw_calls']) {
+    const sorted = frames.map(f => f[field]).sort((a, b) => a - b);
+    result[field] = {
+      min: sorted.length ? sorted[0] : 0,
+      p50: percentile(sorted, 50),
+      p90: percentile(sorted, 90),
+      p99: percentile(sorted, 99),
+      max: sorted.length ? sorted[sorted.length - 1] : 0,
+    };
+  }
+  return result;
+}
+
+function toCSV(frames) {
+  const lines = [FIELDS.join(',')];
+  for(const f of frames)
+    lines.push(FIELDS.map(k => f[k]).join(','));
+  return lines.join('\n') + '\n';
+}
+
+function output(text) {
+  if(argv.output)
+    fs.writeFileSync(argv.output, text);
+  else
+    process.stdout.write(text);
+}
+
+if(!argv.input) {
+  log("Error: --input is required");
+  process.exit(1);
+}
+
+const frames = readFrames(argv.input);
+if(argv.compare) {
+  const before = summary(frames);
+  const after = summary(readFrames(argv.compare));
+  log(`frames: ${before.frames} -> ${after.frames}`);
+  for(const field of ['delta', 'process_time', 'physics_time', 'draw_calls']) {
+    for(const p of ['p50', 'p90', 'p99', 'max']) {
+      const a = before[field][p], b = after[field][p];
+      const change = a ? ((b - a) / a * 100).toFixed(1) + '%' : '-';
+      log(`${field}.${p}: ${a} -> ${b} (${change})`);
+    }
+  }
+}
+else if(argv.format === 'json')
+  output(JSON.stringify(frames));
+else if(argv.format === 'summary')
+  output(JSON.stringify(summary(frames), null, 2) + '\n');
+else
+  output(toCSV(frames));
@@ -0,0 +1,77 @@
+#!/usr/bin/env node
+// Stand-in release server for testing SceneTreeManager.start_release_fetcher
+// Serves the newest .pck of a folder as the latest release:
+//   node release_server.js --dir packs --port 8080
+//   GET /manifest.json  -> { version, url, size, md5 }
+//   GET /<name>.pck     -> pack content, honours "Range: bytes=a-b"
+const fs = require('fs');
+const path = require('path');
+const http = require('http');
+const crypto = require('crypto');
+const argv = require('optimist').argv;
+const log = console.log.bind(console);
+
+const packDir = path.resolve(argv.dir ? argv.dir : ".");
+const port = argv.port ? argv.port : 8080;
+
+function latestPack() {
+  const packs = fs.readdirSync(packDir)
+    .filter(f => f.endsWith('.pck'))
+    .map(f => ({ name: f, stat: fs.statSync(path.join(packDir, f)) }))
+    .sort((a, b) => b.stat.mtime - a.stat.mtime);
+  return packs.length ? packs[0] : null;
+}
+
+function manifest(res) {
+  const pack = latestPack();
+  if(!pack) {
+    res.writeHead(404);
+    return res.end();
+  }
+  // streamed, packs may not fit in a Buffer
+  const hash = crypto.createHash('md5');
+  fs.createReadStream(path.join(packDir, pack.name))
+    .on('data', chunk => hash.update(chunk))
+    .on('error', () => { res.writeHead(500); res.end(); })
+    .on('end', () => {
+      const body = JSON.stringify({
+        version: path.basename(pack.name, '.pck'),
+        url: pack.name,
+        size: pack.stat.size,
+        md5: hash.digest('hex'),
+      });
+      res.writeHead(200, { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(body) });
+      res.end(body);
+    });
+}
+
+function pack(req, res, name) {
+  const file = path.join(packDir, name);
+  if(name.indexOf('..') !== -1 || !fs.existsSync(file)) {
+    res.writeHead(404);
+    return res.end();
+  }
+  const size = fs.statSync(file).size;
+  const range = /bytes=(\d+)-(\d*)/.exec(req.headers.range || '');
+  if(!range) {
+    res.writeHead(200, { 'Content-Length': size });
+    return fs.createReadStream(file).pipe(res);
+  }
+  const start = parseInt(range[1]);
+  const end = range[2] ? Math.min(parseInt(range[2]), size - 1) : size - 1;
+  if(start > end) {
+    res.writeHead(416, { 'Content-Range': `bytes */${size}` });
+    return res.end();
+  }
+  res.writeHead(206, { 'Content-Length': end - start + 1, 'Content-Range': `bytes ${start}-${end}/${size}` });
+  fs.createReadStream(file, { start, end }).pipe(res);
+}
+
+http.createServer((req, res) => {
+  log(req.method, req.url, req.headers.range || '');
+  const name = decodeURIComponent(req.url.split('?')[0].substr(1));
+  if(name === 'manifest.json')
+    manifest(res);
+  else
+    pack(req, res, name);
+}).listen(port, () => log(`Serving releases from ${packDir} on port ${port}`));